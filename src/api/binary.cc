@@ -103,7 +103,7 @@ namespace tempearly
         {
             frame->SetReturnValue(args[0]);
         } else {
-            frame->SetReturnValue(Object::NewBinary(ByteString(b.GetBytes(), b.GetLength() - 1)));
+            frame->SetReturnValue(Object::NewBinary(b.SubString(0, b.GetLength() - 1)));
         }
     }
 
@@ -123,12 +123,12 @@ namespace tempearly
 
             if (length > 1 && b[length - 2] == '\r' && b[length - 1] == '\n')
             {
-                frame->SetReturnValue(Object::NewBinary(ByteString(b.GetBytes(), length - 2)));
+                frame->SetReturnValue(Object::NewBinary(b.SubString(0, length - 2)));
                 return;
             }
             else if (b[length - 1] == '\n' || b[length - 1] == '\r')
             {
-                frame->SetReturnValue(Object::NewBinary(ByteString(b.GetBytes(), length - 1)));
+                frame->SetReturnValue(Object::NewBinary(b.SubString(0, length - 1)));
                 return;
             }
         }
@@ -166,18 +166,9 @@ namespace tempearly
      */
     TEMPEARLY_NATIVE_METHOD(bin_hash)
     {
-        const ByteString b = args[0]->AsBinary();
         i64 hash = 0;
 
-        for (std::size_t i = 0; i < b.GetLength(); ++i)
-        {
-            hash += b[i];
-            hash += (hash << 10);
-            hash ^= (hash >> 6);
-        }
-        hash += (hash << 3);
-        hash ^= (hash >> 11);
-        hash += (hash << 15);
+        args[0]->GetNativeHash(hash);
         frame->SetReturnValue(Object::NewInt(hash));
     }
 
@@ -394,7 +385,7 @@ namespace tempearly
                 interpreter->Throw(interpreter->eIndexError, "Index out of bounds");
                 return;
             }
-            frame->SetReturnValue(Object::NewBinary(ByteString(b.GetBytes() + begin, end - begin)));
+            frame->SetReturnValue(Object::NewBinary(b.SubString(begin, end - begin)));
         } else {
             i64 index;
 
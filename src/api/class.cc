@@ -7,10 +7,18 @@ namespace tempearly
 
     const Class::Allocator Class::kNoAlloc = no_alloc;
 
+    /**
+     * Version of the class hierarchy of the current thread, which is
+     * incremented whenever attributes of any class are modified. Entries of
+     * attribute caches are valid only for the version they were filled at.
+     */
+    static thread_local u64 class_version = 1;
+
     Class::Class(const Handle<Class>& base)
         : m_base(base.Get())
         , m_allocator(m_base ? m_base->m_allocator : nullptr)
-        , m_attributes(nullptr) {}
+        , m_attributes(nullptr)
+        , m_custom_equality(false) {}
 
     Class::~Class()
     {
@@ -47,6 +55,19 @@ namespace tempearly
         }
     }
 
+    bool Class::HasCustomEquality() const
+    {
+        for (const Class* cls = this; cls; cls = cls->m_base)
+        {
+            if (cls->m_custom_equality)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     Dictionary<Handle<Object>> Class::GetOwnAttributes() const
     {
         if (m_attributes)
@@ -84,7 +105,12 @@ namespace tempearly
         {
             m_attributes = new Dictionary<Object*>();
         }
+        if (id.Equals("__hash__") || id.Equals("__eq__"))
+        {
+            m_custom_equality = true;
+        }
         m_attributes->Insert(id, value);
+        ++class_version;
 
         return true;
     }
@@ -106,6 +132,7 @@ namespace tempearly
             m_attributes = new Dictionary<Object*>();
         }
         m_attributes->Insert(name, method);
+        ++class_version;
     }
 
     namespace
@@ -189,6 +216,7 @@ namespace tempearly
             m_attributes = new Dictionary<Object*>();
         }
         m_attributes->Insert(name, method);
+        ++class_version;
     }
 
     namespace
@@ -250,6 +278,7 @@ namespace tempearly
             m_attributes = new Dictionary<Object*>();
         }
         m_attributes->Insert(alias_name, method);
+        ++class_version;
     }
 
     void Class::Mark()
@@ -279,6 +308,63 @@ namespace tempearly
         return Handle<Object>();
     }
 
+    AttributeCache::AttributeCache()
+        : m_next(0)
+    {
+        for (std::size_t i = 0; i < kEntryCount; ++i)
+        {
+            m_entries[i].cls = nullptr;
+            m_entries[i].value = nullptr;
+            m_entries[i].version = 0;
+        }
+    }
+
+    bool AttributeCache::Find(const Handle<Class>& cls, Handle<Object>& slot) const
+    {
+        const u64 version = class_version;
+
+        for (std::size_t i = 0; i < kEntryCount; ++i)
+        {
+            const Entry& entry = m_entries[i];
+
+            if (entry.cls == cls.Get() && entry.version == version)
+            {
+                slot = entry.value;
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void AttributeCache::Insert(const Handle<Class>& cls, const Handle<Object>& value)
+    {
+        Entry& entry = m_entries[m_next];
+
+        m_next = (m_next + 1) % kEntryCount;
+        entry.cls = cls.Get();
+        entry.value = value.Get();
+        entry.version = class_version;
+    }
+
+    void AttributeCache::Mark()
+    {
+        for (std::size_t i = 0; i < kEntryCount; ++i)
+        {
+            const Entry& entry = m_entries[i];
+
+            if (entry.cls && !entry.cls->IsMarked())
+            {
+                entry.cls->Mark();
+            }
+            if (entry.value && !entry.value->IsMarked())
+            {
+                entry.value->Mark();
+            }
+        }
+    }
+
     static Handle<Object> class_alloc_callback(const Handle<Interpreter>& interpreter,
                                                const Handle<Class>& cls)
     {
@@ -45,6 +45,14 @@ namespace tempearly
          */
         bool IsSubclassOf(const Handle<Class>& that) const;
 
+        /**
+         * Returns true if either "__hash__" or "__eq__" method has been
+         * assigned into this class or one of it's superclasses by a script,
+         * in which case values of builtin types cannot be hashed or compared
+         * natively.
+         */
+        bool HasCustomEquality() const;
+
         inline Allocator GetAllocator() const
         {
             return m_allocator;
@@ -98,8 +106,70 @@ namespace tempearly
         Allocator m_allocator;
         /** Contains attributes for the class. */
         Dictionary<Object*>* m_attributes;
+        /** Whether "__hash__" or "__eq__" has been assigned by a script. */
+        bool m_custom_equality;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Class);
     };
+
+    /**
+     * Inline cache which remembers results of attribute lookups from classes
+     * of a few different receivers. Entries are keyed by the class and the
+     * version of the class hierarchy, so that repeated lookups of the same
+     * attribute can skip walking through the attribute dictionaries of the
+     * class and it's superclasses. Each cache must only be used for lookups
+     * of a single attribute name.
+     */
+    class AttributeCache
+    {
+    public:
+        explicit AttributeCache();
+
+        /**
+         * Looks up result of an earlier attribute lookup from given class.
+         * The class hierarchy is not consulted, so a miss only means that
+         * the attribute has to be looked up and stored with
+         * <code>Insert</code>.
+         *
+         * \param cls  Class to look the attribute from
+         * \param slot Where value of the attribute is assigned to
+         * \return     A boolean flag indicating whether a result for the
+         *             class was found in the cache or not
+         */
+        bool Find(const Handle<Class>& cls, Handle<Object>& slot) const;
+
+        /**
+         * Stores result of an attribute lookup from given class into the
+         * cache, replacing the oldest entry when the cache is full.
+         *
+         * \param cls   Class which the attribute was looked up from
+         * \param value Value of the attribute
+         */
+        void Insert(const Handle<Class>& cls, const Handle<Object>& value);
+
+        /**
+         * Used by garbage collector to mark classes and attribute values
+         * stored in the cache.
+         */
+        void Mark();
+
+    private:
+        /** Number of entries in the cache. */
+        static const std::size_t kEntryCount = 4;
+        struct Entry
+        {
+            /** Class which the attribute was looked up from. */
+            Class* cls;
+            /** Value of the attribute. */
+            Object* value;
+            /** Version of the class hierarchy at the time of the lookup. */
+            u64 version;
+        };
+        /** Cached lookup results. */
+        Entry m_entries[kEntryCount];
+        /** Index of the entry which is replaced next. */
+        std::size_t m_next;
+        TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(AttributeCache);
+    };
 }
 
 #endif /* !TEMPEARLY_API_CLASS_H_GUARD */
@@ -486,43 +486,31 @@ namespace tempearly
             {
                 if (m_stream)
                 {
+                    rune runes[Stream::kBufferSize];
                     StringBuilder buffer;
-                    rune r;
+                    std::size_t read;
 
                     if (size > 0)
                     {
                         buffer.Reserve(size);
-                        while (size > 0)
-                        {
-                            Stream::ReadResult result = m_stream->ReadRune(r);
+                    }
+                    for (;;)
+                    {
+                        const std::size_t n = size > 0 && size < Stream::kBufferSize ? size : Stream::kBufferSize;
+                        Stream::ReadResult result = m_stream->ReadRunes(runes, n, read);
 
-                            if (result == Stream::ERROR)
-                            {
-                                return false;
-                            }
-                            else if (result == Stream::SUCCESS)
-                            {
-                                buffer.Append(r);
-                                --size;
-                            } else {
-                                break;
-                            }
+                        if (result == Stream::ERROR)
+                        {
+                            return false;
                         }
-                    } else {
-                        for (;;)
+                        else if (result != Stream::SUCCESS)
                         {
-                            Stream::ReadResult result = m_stream->ReadRune(r);
-
-                            if (result == Stream::ERROR)
-                            {
-                                return false;
-                            }
-                            else if (result == Stream::SUCCESS)
-                            {
-                                buffer.Append(r);
-                            } else {
-                                break;
-                            }
+                            break;
+                        }
+                        buffer.Append(runes, read);
+                        if (size > 0 && !(size -= read))
+                        {
+                            break;
                         }
                     }
                     out = buffer.ToString();
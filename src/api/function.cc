@@ -34,7 +34,7 @@ namespace tempearly
                 }
                 for (std::size_t i = 0; i < m_nodes.GetSize(); ++i)
                 {
-                    const Result result = m_nodes[i]->Execute(interpreter);
+                    const Result result = m_nodes[i]->ExecuteStatement(interpreter);
 
                     switch (result.GetKind())
                     {
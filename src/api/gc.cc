@@ -0,0 +1,136 @@
+#include "interpreter.h"
+#include "api/list.h"
+#include "api/map.h"
+
+namespace tempearly
+{
+    static bool gc_insert(const Handle<Interpreter>& interpreter,
+                          const Handle<MapObject>& map,
+                          const char* name,
+                          const Handle<Object>& value)
+    {
+        const Handle<Object> key = Object::NewString(name);
+        i64 hash;
+
+        return key->GetHash(interpreter, hash)
+            && map->Insert(interpreter, hash, key, value);
+    }
+
+    template< class T >
+    static Handle<Object> gc_list(const Handle<Interpreter>& interpreter,
+                                  const T* values,
+                                  std::size_t count)
+    {
+        Handle<ListObject> list = new ListObject(interpreter->cList);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            list->Append(Object::NewInt(static_cast<i64>(values[i])));
+        }
+
+        return list;
+    }
+
+    static bool gc_block_list(const Handle<Interpreter>& interpreter,
+                              const Vector<Heap::BlockStatistics>& blocks,
+                              Handle<Object>& slot)
+    {
+        Handle<ListObject> list = new ListObject(interpreter->cList);
+
+        for (std::size_t i = 0; i < blocks.GetSize(); ++i)
+        {
+            const Heap::BlockStatistics& block = blocks[i];
+            Handle<MapObject> map = new MapObject(interpreter->cMap);
+
+            if (!gc_insert(interpreter, map, "object_size", Object::NewInt(block.object_size))
+                || !gc_insert(interpreter, map, "live_objects", Object::NewInt(block.live_objects))
+                || !gc_insert(interpreter, map, "live_bytes", Object::NewInt(block.live_bytes))
+                || !gc_insert(interpreter, map, "free_bytes", Object::NewInt(block.free_bytes))
+                || !gc_insert(interpreter, map, "arena", Object::NewBool(block.arena)))
+            {
+                return false;
+            }
+            list->Append(map);
+        }
+        slot = list;
+
+        return true;
+    }
+
+    /**
+     * gc.stats() => Map
+     *
+     * Returns statistics of the garbage collected heap as a map. Durations are
+     * given in microseconds and sizes in bytes.
+     *
+     *     collections          Number of collections in each generation
+     *     arena_collections    Number of collections inside request arenas
+     *     pause_total          Total time spent in collections
+     *     pause_max            Duration of the longest collection
+     *     pause_histogram      Collections bucketed by duration, <10us, <100us
+     *                          and so on
+     *     allocated_objects    Number of objects allocated so far
+     *     allocated_bytes      Number of bytes allocated so far
+     *     allocation_rate      Bytes allocated per second between the two most
+     *                          recent collections
+     *     blocks               Number of memory blocks in use
+     *     spare_blocks         Number of empty blocks kept for reuse
+     *     live_objects         Number of currently allocated objects
+     *     live_bytes           Memory occupied by allocated objects
+     *     free_bytes           Unoccupied memory in used blocks
+     *     block_usage          List of maps describing each block in use,
+     *                          with keys object_size, live_objects,
+     *                          live_bytes, free_bytes and arena
+     *     large_objects        Number of objects in the large object space
+     *     large_bytes          Memory occupied by the large object space
+     *     thresholds           Current collection threshold of each
+     *                          generation
+     */
+    TEMPEARLY_NATIVE_METHOD(gc_stats)
+    {
+        const Heap::Statistics statistics = Heap::GetStatistics();
+        Vector<Heap::BlockStatistics> blocks;
+        Handle<MapObject> map;
+        Handle<Object> block_usage;
+
+        Heap::GetBlockStatistics(blocks);
+        map = new MapObject(interpreter->cMap);
+        if (!gc_block_list(interpreter, blocks, block_usage)
+            || !gc_insert(interpreter, map, "collections", gc_list(interpreter, statistics.collections, 3))
+            || !gc_insert(interpreter, map, "arena_collections", Object::NewInt(statistics.arena_collections))
+            || !gc_insert(interpreter, map, "pause_total", Object::NewInt(statistics.pause_total))
+            || !gc_insert(interpreter, map, "pause_max", Object::NewInt(statistics.pause_max))
+            || !gc_insert(interpreter,
+                          map,
+                          "pause_histogram",
+                          gc_list(interpreter, statistics.pause_histogram, Heap::kPauseBucketCount))
+            || !gc_insert(interpreter, map, "allocated_objects", Object::NewInt(statistics.allocated_objects))
+            || !gc_insert(interpreter, map, "allocated_bytes", Object::NewInt(statistics.allocated_bytes))
+            || !gc_insert(interpreter, map, "allocation_rate", Object::NewInt(statistics.allocation_rate))
+            || !gc_insert(interpreter, map, "blocks", Object::NewInt(statistics.blocks))
+            || !gc_insert(interpreter, map, "spare_blocks", Object::NewInt(statistics.spare_blocks))
+            || !gc_insert(interpreter, map, "live_objects", Object::NewInt(statistics.live_objects))
+            || !gc_insert(interpreter, map, "live_bytes", Object::NewInt(statistics.live_bytes))
+            || !gc_insert(interpreter, map, "free_bytes", Object::NewInt(statistics.free_bytes))
+            || !gc_insert(interpreter, map, "block_usage", block_usage)
+            || !gc_insert(interpreter, map, "large_objects", Object::NewInt(statistics.large_objects))
+            || !gc_insert(interpreter, map, "large_bytes", Object::NewInt(statistics.large_bytes))
+            || !gc_insert(interpreter, map, "thresholds", gc_list(interpreter, statistics.thresholds, 3)))
+        {
+            return;
+        }
+        frame->SetReturnValue(map);
+    }
+
+    void init_gc(Interpreter* i)
+    {
+        Handle<Class> cGC = new Class(i->cObject);
+        Handle<Object> instance = new CustomObject(cGC);
+
+        i->SetGlobalVariable("gc", instance);
+
+        cGC->SetAllocator(Class::kNoAlloc);
+
+        cGC->AddMethod(i, "stats", 0, gc_stats);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef TEMPEARLY_API_HASHKEY_H_GUARD
+#define TEMPEARLY_API_HASHKEY_H_GUARD
+
+#include "interpreter.h"
+
+namespace tempearly
+{
+    /**
+     * Function object which returns the cached hash code of a map or set
+     * entry, for rearranging the hash tables of maps and sets.
+     */
+    template< class Entry >
+    struct HashKeyCode
+    {
+        inline u64 operator()(const Entry* entry) const
+        {
+            return static_cast<u64>(entry->GetHash());
+        }
+    };
+
+    /**
+     * Function object which is used for searching the hash tables of maps and
+     * sets for an entry with given key. Keys are compared only when their
+     * hash codes match, first by identity and then natively if the class of
+     * the key does not override equality. Only other keys are compared by
+     * invoking the "__eq__" method.
+     *
+     * Entries must have a <code>GetHash()</code> method, and the key of an
+     * entry is accessed through member pointer given as template argument.
+     */
+    template< class Entry, Object* Entry::*Key >
+    class HashKeyMatcher
+    {
+    public:
+        /**
+         * Constructs matcher for given key.
+         *
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the key
+         * \param key         Key to look for
+         */
+        explicit HashKeyMatcher(const Handle<Interpreter>& interpreter,
+                                i64 hash,
+                                const Handle<Object>& key)
+            : m_interpreter(interpreter)
+            , m_hash(hash)
+            , m_key(key)
+            , m_native(-1) {}
+
+        /**
+         * Compares key of given entry against the key being searched for.
+         *
+         * \param value Entry to compare
+         * \param equal Where result of the comparison is assigned to
+         * \return      A boolean flag indicating whether the comparison was
+         *              successfull or whether an exception was thrown
+         */
+        bool operator()(Entry* value, bool& equal)
+        {
+            Handle<Entry> entry;
+
+            if (value->GetHash() != m_hash)
+            {
+                equal = false;
+
+                return true;
+            }
+            else if (value->*Key == m_key.Get())
+            {
+                equal = true;
+
+                return true;
+            }
+            if (m_native < 0)
+            {
+                m_native = !m_key->GetClass(m_interpreter)->HasCustomEquality();
+            }
+            if (m_native && m_key->NativeEquals(value->*Key, equal))
+            {
+                return true;
+            }
+            // The entry is kept alive while "__eq__" method runs, because the
+            // method might remove it from the container.
+            entry = value;
+
+            return m_key->Equals(m_interpreter, entry.Get()->*Key, equal);
+        }
+
+    private:
+        /** Script interpreter. */
+        const Handle<Interpreter> m_interpreter;
+        /** Hash code of the key. */
+        const i64 m_hash;
+        /** Key to look for. */
+        const Handle<Object> m_key;
+        /**
+         * Whether the key can be compared natively, or -1 if that has not
+         * been resolved yet.
+         */
+        int m_native;
+        TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(HashKeyMatcher);
+    };
+}
+
+#endif /* !TEMPEARLY_API_HASHKEY_H_GUARD */
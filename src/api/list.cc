@@ -7,61 +7,77 @@ namespace tempearly
 {
     ListObject::ListObject(const Handle<Class>& cls)
         : CustomObject(cls)
+        , m_capacity(0)
+        , m_offset(0)
         , m_size(0)
-        , m_front(nullptr)
-        , m_back(nullptr) {}
+        , m_elements(nullptr) {}
 
-    Handle<ListObject::Link> ListObject::At(std::size_t index) const
+    ListObject::~ListObject()
     {
-        for (Handle<Link> link = m_front; link; link = link->m_next)
-        {
-            if (!index--)
-            {
-                return link;
-            }
-        }
-
-        return Handle<Link>();
+        Memory::Unallocate<Object*>(m_elements);
     }
 
-    void ListObject::Append(const Handle<Object>& value)
+    void ListObject::Reserve(std::size_t front, std::size_t back)
     {
-        Handle<Link> link = new Link(value);
+        const std::size_t needed = m_size + front + back;
+        std::size_t capacity = m_capacity;
+        std::size_t offset;
 
-        if ((link->m_prev = m_back))
+        if (m_offset >= front && m_capacity - m_offset - m_size >= back)
+        {
+            return;
+        }
+        if (needed <= capacity / 2)
+        {
+            // There is plenty of room in the array, it's just at the wrong
+            // end of it. Elements are moved into the middle of the array,
+            // so that the shift is paid for by the operations which follow.
+            offset = front + (capacity - needed) / 2;
+            Memory::Move<Object*>(m_elements + offset, m_elements + m_offset, m_size);
+            m_offset = offset;
+            return;
+        }
+        if (capacity < 8)
         {
-            m_back->m_next = link;
+            capacity = 8;
+        }
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
+        // Lists which are only appended to keep their elements at the
+        // beginning of the array, like vectors do.
+        offset = front ? front + (capacity - needed) / 2 : 0;
+        if (!m_elements)
+        {
+            m_elements = Memory::Allocate<Object*>(capacity);
         } else {
-            m_front = link;
+            Object** old = m_elements;
+
+            m_elements = Memory::Allocate<Object*>(capacity);
+            Memory::Copy<Object*>(m_elements + offset, old + m_offset, m_size);
+            Memory::Unallocate<Object*>(old);
         }
-        m_back = link;
-        ++m_size;
+        m_capacity = capacity;
+        m_offset = offset;
     }
 
-    void ListObject::Append(const Vector<Handle<Object>>& vector)
+    void ListObject::Append(const Handle<Object>& value)
     {
-        if (!vector.IsEmpty())
-        {
-            Handle<Link> front = new Link(vector[0]);
-            Handle<Link> back = front;
+        Reserve(0, 1);
+        m_elements[m_offset + m_size++] = value.Get();
+    }
 
-            for (std::size_t i = 1; i < vector.GetSize(); ++i)
-            {
-                Handle<Link> link = new Link(vector[i]);
+    void ListObject::Append(const Vector<Handle<Object>>& vector)
+    {
+        const std::size_t size = vector.GetSize();
 
-                link->m_prev = back;
-                back->m_next = link;
-                back = link;
-            }
-            if (m_back)
-            {
-                m_back->m_next = front;
-            } else {
-                m_front = front;
-            }
-            m_back = back;
-            m_size += vector.GetSize();
+        Reserve(0, size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            m_elements[m_offset + m_size + i] = vector[i].Get();
         }
+        m_size += size;
     }
 
     void ListObject::AppendAll(const Handle<ListObject>& that)
@@ -70,176 +86,102 @@ namespace tempearly
         {
             return;
         }
-        for (const Link* a = that->m_front; a; a = a->m_next)
-        {
-            Handle<Link> b = new Link(a->m_value);
-
-            if ((b->m_prev = m_back))
-            {
-                m_back->m_next = b;
-            } else {
-                m_front = b;
-            }
-            m_back = b;
-        }
+        Reserve(0, that->m_size);
+        Memory::Copy<Object*>(
+            m_elements + m_offset + m_size,
+            that->m_elements + that->m_offset,
+            that->m_size
+        );
         m_size += that->m_size;
     }
 
     void ListObject::Prepend(const Handle<Object>& value)
     {
-        Handle<Link> link = new Link(value);
-
-        if ((link->m_next = m_front))
-        {
-            m_front->m_prev = link;
-        } else {
-            m_back = link;
-        }
-        m_front = link;
+        Reserve(1, 0);
+        m_elements[--m_offset] = value.Get();
         ++m_size;
     }
 
     void ListObject::Prepend(const Vector<Handle<Object>>& vector)
     {
-        if (!vector.IsEmpty())
-        {
-            Handle<Link> front = new Link(vector[0]);
-            Handle<Link> back = front;
+        const std::size_t size = vector.GetSize();
 
-            for (std::size_t i = 1; i < vector.GetSize(); ++i)
-            {
-                Handle<Link> link = new Link(vector[i]);
-
-                link->m_prev = back;
-                back->m_next = link;
-                back = link;
-            }
-            if (m_front)
-            {
-                back->m_next = m_front;
-            } else {
-                m_back = back;
-            }
-            m_front = front;
-            m_size += vector.GetSize();
+        Reserve(size, 0);
+        m_offset -= size;
+        m_size += size;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            m_elements[m_offset + i] = vector[i].Get();
         }
     }
 
     void ListObject::Insert(std::size_t index, const Handle<Object>& value)
     {
-        Handle<Link> position = At(index);
+        Object** position;
 
-        if (position)
+        if (index >= m_size)
         {
-            Handle<Link> link = new Link(value);
-
-            link->m_prev = position;
-            if (position->m_next)
-            {
-                position->m_next->m_prev = link;
-            } else {
-                m_back = link;
-            }
-            position->m_next = link;
-            ++m_size;
-        } else {
             Append(value);
+            return;
         }
+        // New element is inserted after the element at given index.
+        Reserve(0, 1);
+        position = m_elements + m_offset + index + 1;
+        Memory::Move<Object*>(position + 1, position, m_size - index - 1);
+        *position = value.Get();
+        ++m_size;
     }
 
     void ListObject::Erase(std::size_t index)
     {
-        Handle<Link> link = At(index);
-
-        if (!link)
+        if (index >= m_size)
         {
             return;
         }
-        if (link->m_next && link->m_prev)
+        // Whichever side of the removed element is shorter is shifted over
+        // it.
+        if (index < m_size / 2)
         {
-            link->m_next->m_prev = link->m_prev;
-            link->m_prev->m_next = link->m_next;
-        }
-        else if (link->m_next)
-        {
-            link->m_next->m_prev = nullptr;
-            m_front = link->m_next;
-        }
-        else if (link->m_prev)
-        {
-            link->m_prev->m_next = nullptr;
-            m_back = link->m_prev;
+            Memory::Move<Object*>(m_elements + m_offset + 1, m_elements + m_offset, index);
+            ++m_offset;
         } else {
-            m_front = m_back = nullptr;
+            Object** position = m_elements + m_offset + index;
+
+            Memory::Move<Object*>(position, position + 1, m_size - index - 1);
         }
         --m_size;
     }
 
     bool ListObject::Erase(std::size_t index, Handle<Object>& slot)
     {
-        Handle<Link> link = At(index);
-
-        if (!link)
+        if (index >= m_size)
         {
             return false;
         }
-        if (link->m_next && link->m_prev)
-        {
-            link->m_next->m_prev = link->m_prev;
-            link->m_prev->m_next = link->m_next;
-        }
-        else if (link->m_next)
-        {
-            link->m_next->m_prev = nullptr;
-            m_front = link->m_next;
-        }
-        else if (link->m_prev)
-        {
-            link->m_prev->m_next = nullptr;
-            m_back = link->m_prev;
-        } else {
-            m_front = m_back = nullptr;
-        }
-        --m_size;
-        slot = link->m_value;
+        slot = m_elements[m_offset + index];
+        Erase(index);
 
         return true;
     }
 
     void ListObject::Clear()
     {
-        m_front = m_back = nullptr;
-        m_size = 0;
+        Memory::Unallocate<Object*>(m_elements);
+        m_elements = nullptr;
+        m_capacity = m_offset = m_size = 0;
     }
 
     void ListObject::Mark()
     {
         Object::Mark();
-        if (m_front && !m_front->IsMarked())
+        for (std::size_t i = 0; i < m_size; ++i)
         {
-            m_front->Mark();
-        }
-    }
-
-    ListObject::Link::Link(const Handle<Object>& value)
-        : m_value(value)
-        , m_next(nullptr)
-        , m_prev(nullptr) {}
+            Object* value = m_elements[m_offset + i];
 
-    void ListObject::Link::Mark()
-    {
-        CountedObject::Mark();
-        if (!m_value->IsMarked())
-        {
-            m_value->Mark();
-        }
-        if (m_next && !m_next->IsMarked())
-        {
-            m_next->Mark();
-        }
-        if (m_prev && !m_prev->IsMarked())
-        {
-            m_prev->Mark();
+            if (!value->IsMarked())
+            {
+                value->Mark();
+            }
         }
     }
 
@@ -351,22 +293,21 @@ namespace tempearly
      */
     TEMPEARLY_NATIVE_METHOD(list_index)
     {
+        Handle<ListObject> list = args[0].As<ListObject>();
         const Handle<Object>& needle = args[1];
         bool result;
-        i64 index = 0;
 
-        for (Handle<ListObject::Link> link = args[0].As<ListObject>()->GetFront(); link; link = link->GetNext())
+        for (std::size_t i = 0; i < list->GetSize(); ++i)
         {
-            if (!link->GetValue()->Equals(interpreter, needle, result))
+            if (!list->At(i)->Equals(interpreter, needle, result))
             {
                 return;
             }
             else if (result)
             {
-                frame->SetReturnValue(Object::NewInt(index));
+                frame->SetReturnValue(Object::NewInt(i));
                 return;
             }
-            ++index;
         }
         interpreter->Throw(interpreter->eValueError, "Value is not in the list");
     }
@@ -383,20 +324,18 @@ namespace tempearly
         Handle<ListObject> list = args[0].As<ListObject>();
         const Handle<Object>& needle = args[1];
         bool result;
-        std::size_t index = 0;
 
-        for (Handle<ListObject::Link> link = list->GetFront(); link; link = link->GetNext())
+        for (std::size_t i = 0; i < list->GetSize(); ++i)
         {
-            if (!link->GetValue()->Equals(interpreter, needle, result))
+            if (!list->At(i)->Equals(interpreter, needle, result))
             {
                 return;
             }
             else if (result)
             {
-                list->Erase(index);
+                list->Erase(i);
                 return;
             }
-            ++index;
         }
         interpreter->Throw(interpreter->eValueError, "Value is not in the list");
     }
@@ -432,15 +371,13 @@ namespace tempearly
                 interpreter->Throw(interpreter->eIndexError, "List index out of bounds");
                 return;
             }
+        }
+        else if (list->IsEmpty())
+        {
+            interpreter->Throw(interpreter->eIndexError, "List is empty");
+            return;
         } else {
-            Handle<ListObject::Link> link = list->GetBack();
-
-            if (!link)
-            {
-                interpreter->Throw(interpreter->eIndexError, "List is empty");
-                return;
-            }
-            value = link->GetValue();
+            value = list->GetBack();
             list->Erase(list->GetSize() - 1);
         }
         frame->SetReturnValue(value);
@@ -454,17 +391,14 @@ namespace tempearly
             explicit ListIterator(const Handle<Class>& cls,
                                   const Handle<ListObject>& list)
                 : IteratorObject(cls)
-                , m_link(list->GetFront()) {}
+                , m_list(list)
+                , m_index(0) {}
 
             Result Generate(const Handle<Interpreter>& interpreter)
             {
-                if (m_link)
+                if (m_index < m_list->GetSize())
                 {
-                    const Handle<Object> value = m_link->GetValue();
-
-                    m_link = m_link->GetNext();
-
-                    return Result(Result::KIND_SUCCESS, value);
+                    return Result(Result::KIND_SUCCESS, m_list->At(m_index++));
                 }
 
                 return Result(Result::KIND_BREAK);
@@ -473,14 +407,15 @@ namespace tempearly
             void Mark()
             {
                 IteratorObject::Mark();
-                if (m_link && !m_link->IsMarked())
+                if (!m_list->IsMarked())
                 {
-                    m_link->Mark();
+                    m_list->Mark();
                 }
             }
 
         private:
-            ListObject::Link* m_link;
+            ListObject* m_list;
+            std::size_t m_index;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(ListIterator);
         };
     }
@@ -590,7 +525,6 @@ namespace tempearly
     TEMPEARLY_NATIVE_METHOD(list_getitem)
     {
         Handle<ListObject> list = args[0].As<ListObject>();
-        Handle<ListObject::Link> link;
 
         if (args[1]->IsRange())
         {
@@ -615,10 +549,14 @@ namespace tempearly
             {
                 end += list->GetSize();
             }
+            if (end > static_cast<i64>(list->GetSize()))
+            {
+                end = static_cast<i64>(list->GetSize());
+            }
             result = new ListObject(interpreter->cList);
-            for (link = list->At(begin); link && begin < end; link = link->GetNext(), ++begin)
+            for (; begin >= 0 && begin < end; ++begin)
             {
-                result->Append(link->GetValue());
+                result->Append(list->At(static_cast<std::size_t>(begin)));
             }
             frame->SetReturnValue(result);
         } else {
@@ -632,9 +570,9 @@ namespace tempearly
             {
                 index += list->GetSize();
             }
-            if ((link = list->At(static_cast<std::size_t>(index))))
+            if (index >= 0 && index < static_cast<i64>(list->GetSize()))
             {
-                frame->SetReturnValue(link->GetValue());
+                frame->SetReturnValue(list->At(static_cast<std::size_t>(index)));
             } else {
                 interpreter->Throw(interpreter->eIndexError, "List index out of bounds");
             }
@@ -651,7 +589,6 @@ namespace tempearly
     TEMPEARLY_NATIVE_METHOD(list_setitem)
     {
         Handle<ListObject> list = args[0].As<ListObject>();
-        Handle<ListObject::Link> link;
         i64 index;
 
         if (!args[1]->AsInt(interpreter, index))
@@ -662,9 +599,9 @@ namespace tempearly
         {
             index += list->GetSize();
         }
-        if ((link = list->At(static_cast<std::size_t>(index))))
+        if (index >= 0 && index < static_cast<i64>(list->GetSize()))
         {
-            link->SetValue(args[2]);
+            list->SetAt(static_cast<std::size_t>(index), args[2]);
         } else {
             interpreter->Throw(interpreter->eIndexError, "List index out of bounds");
         }
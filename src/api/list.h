@@ -6,72 +6,14 @@
 namespace tempearly
 {
     /**
-     * Implementation of linked list.
+     * Implementation of list. Elements are stored in a contiguous array which
+     * has spare room at both ends, so that elements can be accessed by their
+     * index in constant time and inserted at either end of the list in
+     * amortized constant time.
      */
     class ListObject : public CustomObject
     {
     public:
-        /**
-         * Represents single entry in the list.
-         */
-        class Link : public CountedObject
-        {
-        public:
-            /**
-             * Constructs new link.
-             *
-             * \param value Value of the link
-             */
-            explicit Link(const Handle<Object>& value);
-
-            /**
-             * Returns value of the link.
-             */
-            inline Handle<Object> GetValue() const
-            {
-                return m_value;
-            }
-
-            /**
-             * Sets value of the link.
-             */
-            inline void SetValue(const Handle<Object>& value)
-            {
-                m_value = value;
-            }
-
-            /**
-             * Returns pointer to next link in the list.
-             */
-            inline Handle<Link> GetNext() const
-            {
-                return m_next;
-            }
-
-            /**
-             * Returns pointer to previous link in the list.
-             */
-            inline Handle<Link> GetPrevious() const
-            {
-                return m_prev;
-            }
-
-            /**
-             * Used by garbage collector to mark the object as used.
-             */
-            void Mark();
-
-        private:
-            /** Value of the entry. */
-            Object* m_value;
-            /** Pointer to next entry in the list. */
-            Link* m_next;
-            /** Pointer to previous entry in the list. */
-            Link* m_prev;
-            friend class ListObject;
-            TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Link);
-        };
-
         /**
          * Constructs empty list.
          *
@@ -79,12 +21,17 @@ namespace tempearly
          */
         explicit ListObject(const Handle<Class>& cls);
 
+        /**
+         * Destructor.
+         */
+        ~ListObject();
+
         /**
          * Returns true if the list is empty.
          */
         inline bool IsEmpty() const
         {
-            return !m_front;
+            return !m_size;
         }
 
         /**
@@ -96,28 +43,38 @@ namespace tempearly
         }
 
         /**
-         * Returns pointer to the first link in the list, or NULL if the list
-         * is empty.
+         * Returns the first element of the list. The list must not be empty.
          */
-        inline Handle<Link> GetFront() const
+        inline Handle<Object> GetFront() const
         {
-            return m_front;
+            return m_elements[m_offset];
         }
 
         /**
-         * Returns pointer to the last link in the list, or NULL if the list is
-         * empty.
+         * Returns the last element of the list. The list must not be empty.
          */
-        inline Handle<Link> GetBack() const
+        inline Handle<Object> GetBack() const
         {
-            return m_back;
+            return m_elements[m_offset + m_size - 1];
         }
 
         /**
-         * Returns an link from specified index or null handle if the index is
-         * out of bounds.
+         * Returns element from specified index. The index must be within
+         * bounds of the list.
          */
-        Handle<Link> At(std::size_t index) const;
+        inline Handle<Object> At(std::size_t index) const
+        {
+            return m_elements[m_offset + index];
+        }
+
+        /**
+         * Replaces element at specified index with given value. The index
+         * must be within bounds of the list.
+         */
+        inline void SetAt(std::size_t index, const Handle<Object>& value)
+        {
+            m_elements[m_offset + index] = value.Get();
+        }
 
         /**
          * Inserts given value into the list.
@@ -183,12 +140,20 @@ namespace tempearly
         void Mark();
 
     private:
-        /** Number of entries stored in the list. */
+        /**
+         * Makes sure that the array has room for at least given number of
+         * elements before the first element and after the last one.
+         */
+        void Reserve(std::size_t front, std::size_t back);
+
+        /** Capacity of the array. */
+        std::size_t m_capacity;
+        /** Index of the first element in the array. */
+        std::size_t m_offset;
+        /** Number of elements stored in the list. */
         std::size_t m_size;
-        /** Pointer to the first link in the list. */
-        Link* m_front;
-        /** Pointer to the last link in the list. */
-        Link* m_back;
+        /** Array containing the elements. */
+        Object** m_elements;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(ListObject);
     };
 }
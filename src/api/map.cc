@@ -1,4 +1,5 @@
 #include "interpreter.h"
+#include "api/hashkey.h"
 #include "api/iterator.h"
 #include "api/list.h"
 #include "api/map.h"
@@ -9,68 +10,96 @@ namespace tempearly
 {
     MapObject::MapObject(const Handle<Class>& cls, std::size_t bucket_size)
         : CustomObject(cls)
-        , m_bucket_size(bucket_size)
-        , m_bucket(Memory::Allocate<Entry*>(m_bucket_size))
         , m_front(nullptr)
         , m_back(nullptr)
-        , m_size(0)
     {
-        for (std::size_t i = 0; i < m_bucket_size; ++i)
+        std::size_t size = 8;
+
+        while (size < bucket_size)
         {
-            m_bucket[i] = nullptr;
+            size *= 2;
         }
+        m_bucket.Reset(size);
     }
 
-    MapObject::~MapObject()
+    MapObject::~MapObject() {}
+
+    bool MapObject::FindSlot(const Handle<Interpreter>& interpreter,
+                             i64 hash,
+                             const Handle<Object>& key,
+                             std::size_t& slot)
     {
-        Memory::Unallocate<Entry*>(m_bucket);
+        HashKeyMatcher<Entry, &Entry::m_key> matcher(interpreter, hash, key);
+
+        return m_bucket.Find(static_cast<u64>(hash), matcher, slot);
     }
 
-    bool MapObject::Has(i64 hash) const
+    void MapObject::Grow()
     {
-        const std::size_t index = static_cast<std::size_t>(hash % m_bucket_size);
+        HashTable<Entry*> bucket(m_bucket.GetSize() * 2);
 
-        for (Entry* entry = m_bucket[index]; entry; entry = entry->m_child)
+        for (Entry* entry = m_front; entry; entry = entry->m_next)
         {
-            if (entry->m_hash == hash)
-            {
-                return true;
-            }
+            bucket.Insert(bucket.FindEmptySlot(static_cast<u64>(entry->m_hash)), entry);
         }
-
-        return false;
+        m_bucket.Swap(bucket);
     }
 
-    bool MapObject::Find(i64 hash, Handle<Object>& slot) const
+    bool MapObject::Has(const Handle<Interpreter>& interpreter,
+                        i64 hash,
+                        const Handle<Object>& key,
+                        bool& slot)
     {
-        const std::size_t index = static_cast<std::size_t>(hash % m_bucket_size);
+        std::size_t index;
 
-        for (Entry* entry = m_bucket[index]; entry; entry = entry->m_child)
+        if (!FindSlot(interpreter, hash, key, index))
         {
-            if (entry->m_hash == hash)
-            {
-                slot = entry->m_value;
+            return false;
+        }
+        slot = !!m_bucket[index];
 
-                return true;
-            }
+        return true;
+    }
+
+    bool MapObject::Find(const Handle<Interpreter>& interpreter,
+                         i64 hash,
+                         const Handle<Object>& key,
+                         Handle<Entry>& slot)
+    {
+        std::size_t index;
+
+        if (!FindSlot(interpreter, hash, key, index))
+        {
+            return false;
         }
+        slot = m_bucket[index];
 
-        return false;
+        return true;
     }
 
-    void MapObject::Insert(i64 hash, const Handle<Object>& key, const Handle<Object>& value)
+    bool MapObject::Insert(const Handle<Interpreter>& interpreter,
+                           i64 hash,
+                           const Handle<Object>& key,
+                           const Handle<Object>& value)
     {
-        std::size_t index = static_cast<std::size_t>(hash % m_bucket_size);
+        std::size_t index;
         Handle<Entry> entry;
 
-        for (entry = m_bucket[index]; entry; entry = entry->m_child)
+        if (!FindSlot(interpreter, hash, key, index))
         {
-            if (entry->m_hash == hash)
-            {
-                entry->m_key = key;
-                entry->m_value = value;
-                return;
-            }
+            return false;
+        }
+        else if ((entry = m_bucket[index]))
+        {
+            entry->m_key = key;
+            entry->m_value = value;
+
+            return true;
+        }
+        if ((m_bucket.GetCount() + 1) * 2 > m_bucket.GetSize())
+        {
+            Grow();
+            index = m_bucket.FindEmptySlot(static_cast<u64>(hash));
         }
         entry = new Entry(hash, key, value);
         if ((entry->m_prev = m_back))
@@ -80,85 +109,51 @@ namespace tempearly
             m_front = entry;
         }
         m_back = entry;
-        entry->m_child = m_bucket[index];
-        m_bucket[index] = entry;
-        ++m_size;
+        m_bucket.Insert(index, entry);
+
+        return true;
     }
 
-    bool MapObject::Erase(i64 hash, Handle<Object>& slot)
+    bool MapObject::Erase(const Handle<Interpreter>& interpreter,
+                          i64 hash,
+                          const Handle<Object>& key,
+                          Handle<Entry>& slot)
     {
-        const std::size_t index = static_cast<std::size_t>(hash % m_bucket_size);
-        Handle<Entry> entry = m_bucket[index];
+        std::size_t index;
+        Entry* entry;
 
-        if (!entry)
+        if (!FindSlot(interpreter, hash, key, index))
         {
             return false;
         }
-        if (entry->m_hash == hash)
+        else if (!(entry = m_bucket[index]))
         {
-            m_bucket[index] = entry->m_child;
-            if (entry->m_next && entry->m_prev)
-            {
-                entry->m_next->m_prev = entry->m_prev;
-                entry->m_prev->m_next = entry->m_next;
-            }
-            else if (entry->m_next)
-            {
-                entry->m_next->m_prev = nullptr;
-                m_front = entry->m_next;
-            }
-            else if (entry->m_prev)
-            {
-                entry->m_prev->m_next = nullptr;
-                m_back = entry->m_prev;
-            } else {
-                m_front = m_back = nullptr;
-            }
-            slot = entry->m_value;
-
             return true;
         }
-        for (; entry->m_child; entry = entry->m_child)
+        // The entry keeps it's own links, so that iterators which are
+        // currently positioned at it can still advance to the next entry.
+        if (entry->m_next)
         {
-            if (entry->m_child->m_hash == hash)
-            {
-                Entry* child = entry->m_child;
-
-                entry->m_child = entry->m_child->m_child;
-                if (child->m_next && child->m_prev)
-                {
-                    child->m_next->m_prev = child->m_prev;
-                    child->m_prev->m_next = child->m_next;
-                }
-                else if (child->m_next)
-                {
-                    child->m_next->m_prev = nullptr;
-                    m_front = child->m_next;
-                }
-                else if (child->m_prev)
-                {
-                    child->m_prev->m_next = nullptr;
-                    m_back = child->m_prev;
-                } else {
-                    m_front = m_back = nullptr;
-                }
-                slot = child->m_value;
-
-                return true;
-            }
+            entry->m_next->m_prev = entry->m_prev;
+        } else {
+            m_back = entry->m_prev;
         }
+        if (entry->m_prev)
+        {
+            entry->m_prev->m_next = entry->m_next;
+        } else {
+            m_front = entry->m_next;
+        }
+        slot = entry;
+        m_bucket.Erase(index, HashKeyCode<Entry>());
 
-        return false;
+        return true;
     }
 
     void MapObject::Clear()
     {
-        for (std::size_t i = 0; i < m_bucket_size; ++i)
-        {
-            m_bucket[i] = nullptr;
-        }
+        m_bucket.Clear();
         m_front = m_back = nullptr;
-        m_size = 0;
     }
 
     void MapObject::Mark()
@@ -175,8 +170,7 @@ namespace tempearly
         , m_key(key)
         , m_value(value)
         , m_next(nullptr)
-        , m_prev(nullptr)
-        , m_child(nullptr) {}
+        , m_prev(nullptr) {}
 
     void MapObject::Entry::Mark()
     {
@@ -197,10 +191,6 @@ namespace tempearly
         {
             m_prev->Mark();
         }
-        if (m_child && !m_child->IsMarked())
-        {
-            m_child->Mark();
-        }
     }
 
     static Handle<Object> map_alloc(const Handle<Interpreter>& interpreter,
@@ -233,7 +223,10 @@ namespace tempearly
 
         for (Handle<MapObject::Entry> e = map->GetFront(); e; e = e->GetNext())
         {
-            set->Add(e->GetHash(), e->GetKey());
+            if (!set->Add(interpreter, e->GetHash(), e->GetKey()))
+            {
+                return;
+            }
         }
         frame->SetReturnValue(set);
     }
@@ -265,10 +258,12 @@ namespace tempearly
     TEMPEARLY_NATIVE_METHOD(map_has)
     {
         i64 hash;
+        bool result;
 
-        if (args[1]->GetHash(interpreter, hash))
+        if (args[1]->GetHash(interpreter, hash)
+            && args[0].As<MapObject>()->Has(interpreter, hash, args[1], result))
         {
-            frame->SetReturnValue(Object::NewBool(args[0].As<MapObject>()->Has(hash)));
+            frame->SetReturnValue(Object::NewBool(result));
         }
     }
 
@@ -284,18 +279,18 @@ namespace tempearly
         Handle<MapObject::Entry> entry;
         i64 hash;
 
-        if (args[1]->GetHash(interpreter, hash))
+        if (!args[1]->GetHash(interpreter, hash)
+            || !args[0].As<MapObject>()->Find(interpreter, hash, args[1], entry))
         {
-            Handle<Object> value;
-
-            if (args[0].As<MapObject>()->Find(hash, value))
-            {
-                frame->SetReturnValue(value);
-            }
-            else if (args.GetSize() > 2)
-            {
-                frame->SetReturnValue(args[2]);
-            }
+            return;
+        }
+        else if (entry)
+        {
+            frame->SetReturnValue(entry->GetValue());
+        }
+        else if (args.GetSize() > 2)
+        {
+            frame->SetReturnValue(args[2]);
         }
     }
 
@@ -324,15 +319,17 @@ namespace tempearly
     TEMPEARLY_NATIVE_METHOD(map_pop)
     {
         i64 hash;
+        Handle<MapObject::Entry> entry;
         Handle<Object> value;
 
-        if (!args[1]->GetHash(interpreter, hash))
+        if (!args[1]->GetHash(interpreter, hash)
+            || !args[0].As<MapObject>()->Erase(interpreter, hash, args[1], entry))
         {
             return;
         }
-        else if (args[0].As<MapObject>()->Erase(hash, value))
+        else if (entry)
         {
-            frame->SetReturnValue(value);
+            frame->SetReturnValue(entry->GetValue());
         }
         else if (args.GetSize() > 2)
         {
@@ -436,11 +433,11 @@ namespace tempearly
             const Handle<Object> key = entry->GetKey();
             const Handle<Object> value = entry->GetValue();
 
-            if (!value->GetHash(interpreter, hash))
+            if (!value->GetHash(interpreter, hash)
+                || !result->Insert(interpreter, hash, value, key))
             {
                 return;
             }
-            result->Insert(hash, value, key);
         }
         frame->SetReturnValue(result);
     }
@@ -463,7 +460,10 @@ namespace tempearly
         other = args[1].As<MapObject>();
         for (Handle<MapObject::Entry> entry = other->GetFront(); entry; entry = entry->GetNext())
         {
-            map->Insert(entry->GetHash(), entry->GetKey(), entry->GetValue());
+            if (!map->Insert(interpreter, entry->GetHash(), entry->GetKey(), entry->GetValue()))
+            {
+                return;
+            }
         }
         frame->SetReturnValue(args[0]);
     }
@@ -544,17 +544,21 @@ namespace tempearly
     TEMPEARLY_NATIVE_METHOD(map_getitem)
     {
         Handle<MapObject::Entry> entry;
+        Handle<Object> value;
         i64 hash;
 
-        if (args[1]->GetHash(interpreter, hash))
+        if (!args[1]->GetHash(interpreter, hash)
+            || !args[0].As<MapObject>()->Find(interpreter, hash, args[1], entry))
         {
-            Handle<Object> value;
-
-            if (args[0].As<MapObject>()->Find(hash, value)
-                || args[0]->CallMethod(interpreter, value, "__missing__", args[1]))
-            {
-                frame->SetReturnValue(value);
-            }
+            return;
+        }
+        else if (entry)
+        {
+            frame->SetReturnValue(entry->GetValue());
+        }
+        else if (args[0]->CallMethod(interpreter, value, "__missing__", args[1]))
+        {
+            frame->SetReturnValue(value);
         }
     }
 
@@ -576,12 +580,11 @@ namespace tempearly
         const Handle<Object>& value = args[2];
         i64 hash;
 
-        if (!key->GetHash(interpreter, hash))
+        if (key->GetHash(interpreter, hash)
+            && args[0].As<MapObject>()->Insert(interpreter, hash, key, value))
         {
-            return;
+            frame->SetReturnValue(args[0]);
         }
-        args[0].As<MapObject>()->Insert(hash, key, value);
-        frame->SetReturnValue(args[0]);
     }
 
     /**
@@ -673,12 +676,18 @@ namespace tempearly
         result = new MapObject(interpreter->cMap);
         for (Handle<MapObject::Entry> entry = map->GetFront(); entry; entry = entry->GetNext())
         {
-            result->Insert(entry->GetHash(), entry->GetKey(), entry->GetValue());
+            if (!result->Insert(interpreter, entry->GetHash(), entry->GetKey(), entry->GetValue()))
+            {
+                return;
+            }
         }
         other = args[1].As<MapObject>();
         for (Handle<MapObject::Entry> entry = other->GetFront(); entry; entry = entry->GetNext())
         {
-            result->Insert(entry->GetHash(), entry->GetKey(), entry->GetValue());
+            if (!result->Insert(interpreter, entry->GetHash(), entry->GetKey(), entry->GetValue()))
+            {
+                return;
+            }
         }
         frame->SetReturnValue(result);
     }
@@ -2,11 +2,14 @@
 #define TEMPEARLY_API_MAP_H_GUARD
 
 #include "customobject.h"
+#include "core/hashtable.h"
 
 namespace tempearly
 {
     /**
-     * Implementation of hash map object which stores pairs of values.
+     * Implementation of hash map object which stores pairs of values. Entries
+     * are linked together in insertion order and looked up through an open
+     * addressing hash table, which is grown as entries are inserted.
      */
     class MapObject : public CustomObject
     {
@@ -94,8 +97,6 @@ namespace tempearly
             Entry* m_next;
             /** Pointer to previous entry. */
             Entry* m_prev;
-            /** Pointer to next entry in hash table. */
-            Entry* m_child;
             friend class MapObject;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Entry);
         };
@@ -104,9 +105,10 @@ namespace tempearly
          * Constructs new map object.
          *
          * \param cls         Class of the object
-         * \param bucket_size Size of the hash table.
+         * \param bucket_size Initial size of the hash table, which is rounded
+         *                    up to a power of two
          */
-        explicit MapObject(const Handle<Class>& cls, std::size_t bucket_size = 32);
+        explicit MapObject(const Handle<Class>& cls, std::size_t bucket_size = 16);
 
         /**
          * Destructor.
@@ -126,7 +128,7 @@ namespace tempearly
          */
         inline std::size_t GetSize() const
         {
-            return m_size;
+            return m_bucket.GetCount();
         }
 
         /**
@@ -148,43 +150,74 @@ namespace tempearly
         }
 
         /**
-         * Returns true if map contains an entry for given hash code.
+         * Tests whether the map contains an entry with given key.
+         *
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the key
+         * \param key         Key to look for
+         * \param slot        Where result of the test is assigned to
+         * \return            A boolean flag indicating whether the test was
+         *                    successfull or whether an exception was thrown
          */
-        bool Has(i64 hash) const;
+        bool Has(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& key,
+            bool& slot
+        );
 
         /**
-         * Searches for an entry from the map.
+         * Searches for an entry with given key from the map.
          *
-         * \param hash Hash code to look for
-         * \param slot Where value of the entry is assigned to
-         * \return     A boolean flag indicating whether entry with given hash
-         *             code was found or not
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the key
+         * \param key         Key to look for
+         * \param slot        Where the entry is assigned to, if it's found
+         * \return            A boolean flag indicating whether the search was
+         *                    successfull or whether an exception was thrown
          */
-        bool Find(i64 hash, Handle<Object>& slot) const;
+        bool Find(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& key,
+            Handle<Entry>& slot
+        );
 
         /**
-         * Inserts an entry into the map. Existing entries with same hash code
-         * are overridden.
+         * Inserts an entry into the map. Existing entry with same key is
+         * overridden.
          *
-         * \param hash  Hash code of the entry
-         * \param key   Key value of the entry
-         * \param value Value of the entry
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the key
+         * \param key         Key value of the entry
+         * \param value       Value of the entry
+         * \return            A boolean flag indicating whether the entry was
+         *                    inserted or whether an exception was thrown
          */
-        void Insert(
+        bool Insert(
+            const Handle<Interpreter>& interpreter,
             i64 hash,
             const Handle<Object>& key,
             const Handle<Object>& value
         );
 
         /**
-         * Removes an entry from the map.
+         * Removes an entry with given key from the map.
          *
-         * \param hash Hash code to look for
-         * \param slot Where value of the removed entry is assigned to
-         * \return     A boolean flag indicating whether entry with given hash
-         *             code was found or not
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the key
+         * \param key         Key to look for
+         * \param slot        Where the removed entry is assigned to, if it's
+         *                    found
+         * \return            A boolean flag indicating whether the search was
+         *                    successfull or whether an exception was thrown
          */
-        bool Erase(i64 hash, Handle<Object>& slot);
+        bool Erase(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& key,
+            Handle<Entry>& slot
+        );
 
         /**
          * Removes all entries from the map.
@@ -203,16 +236,33 @@ namespace tempearly
         void Mark();
 
     private:
-        /** Size of the hash table. */
-        const std::size_t m_bucket_size;
-        /** The hash table. */
-        Entry** m_bucket;
+        /**
+         * Searches the hash table for an entry with given key. Keys are
+         * compared only when their hash codes match. Index of the slot which
+         * contains the entry, or of the empty slot where such entry would be
+         * inserted, is assigned to <em>slot</em>.
+         *
+         * \return A boolean flag indicating whether the search was
+         *         successfull or whether an exception was thrown
+         */
+        bool FindSlot(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& key,
+            std::size_t& slot
+        );
+
+        /**
+         * Doubles the size of the hash table.
+         */
+        void Grow();
+
+        /** The hash table, which is kept at most half full. */
+        HashTable<Entry*> m_bucket;
         /** First entry in the map. */
         Entry* m_front;
         /** Last entry in the map. */
         Entry* m_back;
-        /** Number of key-value entries stored in the map. */
-        std::size_t m_size;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(MapObject);
     };
 }
@@ -700,23 +700,10 @@ namespace tempearly
      */
     TEMPEARLY_NATIVE_METHOD(flo_hash)
     {
-        double f = args[0]->AsFloat();
-        i64 i;
+        i64 hash = 0;
 
-        if (std::isnan(f))
-        {
-            i = 0x7ff8000000000000LL;
-        } else {
-            union
-            {
-                i64 i;
-                double f;
-            } shaker;
-
-            shaker.f = f;
-            i = shaker.i;
-        }
-        frame->SetReturnValue(Object::NewInt(i ^ (static_cast<u64>(i >> 32))));
+        args[0]->GetNativeHash(hash);
+        frame->SetReturnValue(Object::NewInt(hash));
     }
 
     /**
@@ -274,11 +274,11 @@ namespace tempearly
                 const Handle<Object> value = Object::NewString(values[i]);
                 i64 hash;
 
-                if (!value->GetHash(interpreter, hash))
+                if (!value->GetHash(interpreter, hash)
+                    || !set->Add(interpreter, hash, value))
                 {
                     return;
                 }
-                set->Add(hash, value);
             }
         }
         frame->SetReturnValue(set);
@@ -1,4 +1,5 @@
 #include "interpreter.h"
+#include "api/hashkey.h"
 #include "api/iterator.h"
 #include "api/set.h"
 
@@ -6,50 +7,78 @@ namespace tempearly
 {
     SetObject::SetObject(const Handle<Class>& cls, std::size_t bucket_size)
         : CustomObject(cls)
-        , m_bucket_size(bucket_size)
-        , m_bucket(Memory::Allocate<Entry*>(m_bucket_size))
-        , m_size(0)
         , m_front(nullptr)
         , m_back(nullptr)
     {
-        for (std::size_t i = 0; i < m_bucket_size; ++i)
+        std::size_t size = 8;
+
+        while (size < bucket_size)
         {
-            m_bucket[i] = nullptr;
+            size *= 2;
         }
+        m_bucket.Reset(size);
     }
 
-    SetObject::~SetObject()
+    SetObject::~SetObject() {}
+
+    bool SetObject::FindSlot(const Handle<Interpreter>& interpreter,
+                             i64 hash,
+                             const Handle<Object>& value,
+                             std::size_t& slot)
     {
-        Memory::Unallocate<Entry*>(m_bucket);
+        HashKeyMatcher<Entry, &Entry::m_value> matcher(interpreter, hash, value);
+
+        return m_bucket.Find(static_cast<u64>(hash), matcher, slot);
     }
 
-    bool SetObject::Has(i64 hash) const
+    void SetObject::Grow()
     {
-        const std::size_t index = static_cast<std::size_t>(hash % m_bucket_size);
+        HashTable<Entry*> bucket(m_bucket.GetSize() * 2);
 
-        for (Entry* e = m_bucket[index]; e; e = e->m_child)
+        for (Entry* e = m_front; e; e = e->m_next)
         {
-            if (e->m_hash == hash)
-            {
-                return true;
-            }
+            bucket.Insert(bucket.FindEmptySlot(static_cast<u64>(e->m_hash)), e);
         }
+        m_bucket.Swap(bucket);
+    }
+
+    bool SetObject::Has(const Handle<Interpreter>& interpreter,
+                        i64 hash,
+                        const Handle<Object>& value,
+                        bool& slot)
+    {
+        std::size_t index;
 
-        return false;
+        if (!FindSlot(interpreter, hash, value, index))
+        {
+            return false;
+        }
+        slot = !!m_bucket[index];
+
+        return true;
     }
 
-    void SetObject::Add(i64 hash, const Handle<Object>& value)
+    bool SetObject::Add(const Handle<Interpreter>& interpreter,
+                        i64 hash,
+                        const Handle<Object>& value)
     {
-        const std::size_t index = static_cast<std::size_t>(hash % m_bucket_size);
+        std::size_t index;
         Handle<Entry> e;
 
-        for (e = m_bucket[index]; e; e = e->m_child)
+        if (!FindSlot(interpreter, hash, value, index))
         {
-            if (e->m_hash == hash)
-            {
-                e->m_value = value;
-                return;
-            }
+            return false;
+        }
+        else if ((e = m_bucket[index]))
+        {
+            e->m_value = value;
+
+            return true;
+        }
+        if ((m_bucket.GetCount() + 1) * 2 > m_bucket.GetSize())
+        {
+            Grow();
+            index = m_bucket.FindEmptySlot(static_cast<u64>(hash));
         }
         e = new Entry(hash, value);
         if ((e->m_prev = m_back))
@@ -59,123 +88,71 @@ namespace tempearly
             m_front = e;
         }
         m_back = e;
-        e->m_child = m_bucket[index];
-        m_bucket[index] = e;
-        ++m_size;
+        m_bucket.Insert(index, e);
+
+        return true;
     }
-    
-    void SetObject::AddAll(const Handle<SetObject>& that)
+
+    bool SetObject::AddAll(const Handle<Interpreter>& interpreter,
+                           const Handle<SetObject>& that)
     {
         if (this == that.Get())
         {
-            return;
+            return true;
         }
-        for (Entry* a = that->m_front; a; a = a->m_next)
+        for (Handle<Entry> a = that->m_front; a; a = a->m_next)
         {
-            const std::size_t index = static_cast<std::size_t>(a->m_hash % m_bucket_size);
-            bool found = false;
-
-            for (Handle<Entry> b = m_bucket[index]; b; b = b->m_child)
-            {
-                if (b->m_hash == a->m_hash)
-                {
-                    b->m_value = a->m_value;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
+            if (!Add(interpreter, a->m_hash, a->m_value))
             {
-                Handle<Entry> b = new Entry(a->m_hash, a->m_value);
-
-                if ((b->m_prev = m_back))
-                {
-                    m_back->m_next = b;
-                } else {
-                    m_front = b;
-                }
-                m_back = b;
-                b->m_child = m_bucket[index];
-                m_bucket[index] = b;
-                ++m_size;
+                return false;
             }
         }
+
+        return true;
     }
 
-    bool SetObject::Remove(i64 hash)
+    bool SetObject::Remove(const Handle<Interpreter>& interpreter,
+                           i64 hash,
+                           const Handle<Object>& value,
+                           bool& slot)
     {
-        const std::size_t index = static_cast<std::size_t>(hash % m_bucket_size);
-        Entry* entry = m_bucket[index];
+        std::size_t index;
+        Entry* entry;
 
-        if (!entry)
+        if (!FindSlot(interpreter, hash, value, index))
         {
             return false;
         }
-        if (entry->m_hash == hash)
+        else if (!(entry = m_bucket[index]))
         {
-            m_bucket[index] = entry->m_child;
-            if (entry->m_next && entry->m_prev)
-            {
-                entry->m_next->m_prev = entry->m_prev;
-                entry->m_prev->m_next = entry->m_next;
-            }
-            else if (entry->m_next)
-            {
-                entry->m_next->m_prev = nullptr;
-                m_front = entry->m_next;
-            }
-            else if (entry->m_prev)
-            {
-                entry->m_prev->m_next = nullptr;
-                m_back = entry->m_prev;
-            } else {
-                m_front = m_back = nullptr;
-            }
-            --m_size;
+            slot = false;
 
             return true;
         }
-        for (; entry->m_child; entry = entry->m_child)
+        // The entry keeps it's own links, so that iterators which are
+        // currently positioned at it can still advance to the next entry.
+        if (entry->m_next)
         {
-            if (entry->m_child->m_hash == hash)
-            {
-                Entry* child = entry->m_child;
-
-                entry->m_child = entry->m_child->m_child;
-                if (child->m_next && child->m_prev)
-                {
-                    child->m_next->m_prev = child->m_prev;
-                    child->m_prev->m_next = child->m_next;
-                }
-                else if (child->m_next)
-                {
-                    child->m_next->m_prev = nullptr;
-                    m_front = child->m_next;
-                }
-                else if (child->m_prev)
-                {
-                    child->m_prev->m_next = nullptr;
-                    m_back = child->m_prev;
-                } else {
-                    m_front = m_back = nullptr;
-                }
-                --m_size;
-
-                return true;
-            }
+            entry->m_next->m_prev = entry->m_prev;
+        } else {
+            m_back = entry->m_prev;
+        }
+        if (entry->m_prev)
+        {
+            entry->m_prev->m_next = entry->m_next;
+        } else {
+            m_front = entry->m_next;
         }
+        slot = true;
+        m_bucket.Erase(index, HashKeyCode<Entry>());
 
-        return false;
+        return true;
     }
 
     void SetObject::Clear()
     {
-        for (std::size_t i = 0; i < m_bucket_size; ++i)
-        {
-            m_bucket[i] = nullptr;
-        }
+        m_bucket.Clear();
         m_front = m_back = nullptr;
-        m_size = 0;
     }
 
     void SetObject::Mark()
@@ -191,8 +168,7 @@ namespace tempearly
         : m_hash(hash)
         , m_value(value)
         , m_next(nullptr)
-        , m_prev(nullptr)
-        , m_child(nullptr) {}
+        , m_prev(nullptr) {}
 
     void SetObject::Entry::Mark()
     {
@@ -209,10 +185,6 @@ namespace tempearly
         {
             m_prev->Mark();
         }
-        if (m_child && !m_child->IsMarked())
-        {
-            m_child->Mark();
-        }
     }
 
     static Handle<Object> set_alloc(const Handle<Interpreter>& interpreter,
@@ -239,11 +211,11 @@ namespace tempearly
             const Handle<Object>& object = args[i];
             i64 hash;
 
-            if (!object->GetHash(interpreter, hash))
+            if (!object->GetHash(interpreter, hash)
+                || !set->Add(interpreter, hash, object))
             {
                 return;
             }
-            set->Add(hash, object);
         }
     }
 
@@ -343,16 +315,18 @@ namespace tempearly
     /**
      * Set#has(object) => Bool
      *
-     * Returns true if set contains given object. Objects are identified by
-     * their hash codes.
+     * Returns true if set contains given object. Objects are compared with
+     * their "__eq__" method when their hash codes match.
      */
     TEMPEARLY_NATIVE_METHOD(set_has)
     {
         i64 hash;
+        bool result;
 
-        if (args[1]->GetHash(interpreter, hash))
+        if (args[1]->GetHash(interpreter, hash)
+            && args[0].As<SetObject>()->Has(interpreter, hash, args[1], result))
         {
-            frame->SetReturnValue(Object::NewBool(args[0].As<SetObject>()->Has(hash)));
+            frame->SetReturnValue(Object::NewBool(result));
         }
     }
 
@@ -370,11 +344,11 @@ namespace tempearly
             const Handle<Object>& object = args[i];
             i64 hash;
 
-            if (!object->GetHash(interpreter, hash))
+            if (!object->GetHash(interpreter, hash)
+                || !set->Add(interpreter, hash, object))
             {
                 return;
             }
-            set->Add(hash, object);
         }
         frame->SetReturnValue(args[0]);
     }
@@ -388,12 +362,14 @@ namespace tempearly
     TEMPEARLY_NATIVE_METHOD(set_remove)
     {
         i64 hash;
+        bool removed;
 
-        if (!args[1]->GetHash(interpreter, hash))
+        if (!args[1]->GetHash(interpreter, hash)
+            || !args[0].As<SetObject>()->Remove(interpreter, hash, args[1], removed))
         {
             return;
         }
-        else if (!args[0].As<SetObject>()->Remove(hash))
+        else if (!removed)
         {
             String repr;
 
@@ -413,10 +389,12 @@ namespace tempearly
     TEMPEARLY_NATIVE_METHOD(set_discard)
     {
         i64 hash;
+        bool removed;
 
-        if (args[1]->GetHash(interpreter, hash))
+        if (args[1]->GetHash(interpreter, hash)
+            && args[0].As<SetObject>()->Remove(interpreter, hash, args[1], removed))
         {
-            frame->SetReturnValue(Object::NewBool(args[0].As<SetObject>()->Remove(hash)));
+            frame->SetReturnValue(Object::NewBool(removed));
         }
     }
 
@@ -432,13 +410,16 @@ namespace tempearly
     {
         Handle<SetObject> set = args[0].As<SetObject>();
         Handle<SetObject::Entry> entry = set->GetBack();
+        bool removed;
 
-        if (entry && set->Remove(entry->GetHash()))
+        if (!entry)
         {
-            frame->SetReturnValue(entry->GetValue());
-        } else {
             interpreter->Throw(interpreter->eKeyError, "Set is empty");
         }
+        else if (set->Remove(interpreter, entry->GetHash(), entry->GetValue(), removed))
+        {
+            frame->SetReturnValue(entry->GetValue());
+        }
     }
 
     /**
@@ -475,14 +456,17 @@ namespace tempearly
             return;
         }
         result = new SetObject(interpreter->cSet);
-        result->AddAll(original);
+        if (!result->AddAll(interpreter, original))
+        {
+            return;
+        }
         while (iterator->GetNext(interpreter, element))
         {
-            if (!element->GetHash(interpreter, hash))
+            if (!element->GetHash(interpreter, hash)
+                || !result->Add(interpreter, hash, element))
             {
                 return;
             }
-            result->Add(hash, element);
         }
         if (!interpreter->HasException())
         {
@@ -507,20 +491,24 @@ namespace tempearly
         Handle<Object> iterator;
         Handle<Object> element;
         i64 hash;
+        bool removed;
 
         if (!args[1]->CallMethod(interpreter, iterator, "__iter__"))
         {
             return;
         }
         result = new SetObject(interpreter->cSet);
-        result->AddAll(original);
+        if (!result->AddAll(interpreter, original))
+        {
+            return;
+        }
         while (iterator->GetNext(interpreter, element))
         {
-            if (!element->GetHash(interpreter, hash))
+            if (!element->GetHash(interpreter, hash)
+                || !result->Remove(interpreter, hash, element, removed))
             {
                 return;
             }
-            result->Remove(hash);
         }
         if (!interpreter->HasException())
         {
@@ -541,6 +529,7 @@ namespace tempearly
         Handle<Object> iterator;
         Handle<Object> element;
         i64 hash;
+        bool found;
 
         if (!args[1]->CallMethod(interpreter, iterator, "__iter__"))
         {
@@ -549,14 +538,12 @@ namespace tempearly
         result = new SetObject(interpreter->cSet);
         while (iterator->GetNext(interpreter, element))
         {
-            if (!element->GetHash(interpreter, hash))
+            if (!element->GetHash(interpreter, hash)
+                || !original->Has(interpreter, hash, element, found)
+                || (found && !result->Add(interpreter, hash, element)))
             {
                 return;
             }
-            else if (original->Has(hash))
-            {
-                result->Add(hash, element);
-            }
         }
         if (!interpreter->HasException())
         {
@@ -2,12 +2,15 @@
 #define TEMPEARLY_API_SET_H_GUARD
 
 #include "object.h"
+#include "core/hashtable.h"
 
 namespace tempearly
 {
     /**
      * Set is an unordered container where each value can exist only once.
-     * Values are identified by their hash codes.
+     * Values are identified by their hash codes. Entries are linked together
+     * in insertion order and looked up through an open addressing hash table,
+     * which is grown as entries are inserted.
      */
     class SetObject : public CustomObject
     {
@@ -80,8 +83,6 @@ namespace tempearly
             Entry* m_next;
             /** Pointer to previous entry in the set. */
             Entry* m_prev;
-            /** Pointer to child entry in hash table. */
-            Entry* m_child;
             friend class SetObject;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Entry);
         };
@@ -90,10 +91,11 @@ namespace tempearly
          * Constructs empty set.
          *
          * \param cls         Class of the object
-         * \param bucket_size Capacity of the hash table which provides fast
-         *                    access of elements
+         * \param bucket_size Initial capacity of the hash table which provides
+         *                    fast access of elements, rounded up to a power
+         *                    of two
          */
-        explicit SetObject(const Handle<Class>& cls, std::size_t bucket_size = 32);
+        explicit SetObject(const Handle<Class>& cls, std::size_t bucket_size = 16);
 
         /**
          * Destructor.
@@ -113,7 +115,7 @@ namespace tempearly
          */
         inline std::size_t GetSize() const
         {
-            return m_size;
+            return m_bucket.GetCount();
         }
 
         /**
@@ -135,36 +137,68 @@ namespace tempearly
         }
 
         /**
-         * Searches for an entry based on the hash code.
+         * Tests whether the set contains given value.
          *
-         * \param hash Hash code to look for
-         * \return     A boolean flag indicating whether the set has an entry
-         *             with given hash code
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the value
+         * \param value       Value to look for
+         * \param slot        Where result of the test is assigned to
+         * \return            A boolean flag indicating whether the test was
+         *                    successfull or whether an exception was thrown
          */
-        bool Has(i64 hash) const;
+        bool Has(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& value,
+            bool& slot
+        );
 
         /**
-         * Inserts an entry to the set. Existing entries with same hash code
-         * are overridden.
+         * Inserts an entry to the set. Existing entry with equal value is
+         * overridden.
          *
-         * \param hash  Hash code of the entry to insert
-         * \param value Value of the entry to insert
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the value
+         * \param value       Value of the entry to insert
+         * \return            A boolean flag indicating whether the entry was
+         *                    inserted or whether an exception was thrown
          */
-        void Add(i64 hash, const Handle<Object>& value);
+        bool Add(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& value
+        );
 
         /**
          * Inserts all entries from given set into this one.
+         *
+         * \param interpreter Script interpreter
+         * \param that        Set to insert entries from
+         * \return            A boolean flag indicating whether the entries
+         *                    were inserted or whether an exception was thrown
          */
-        void AddAll(const Handle<SetObject>& that);
+        bool AddAll(
+            const Handle<Interpreter>& interpreter,
+            const Handle<SetObject>& that
+        );
 
         /**
-         * Removes an entry with given hash code from the set.
+         * Removes an entry with given value from the set.
          *
-         * \param hash Hash code to look for
-         * \®eturn     A boolean flag indicating whether an entry with given
-         *             hash code was found from the set
+         * \param interpreter Script interpreter
+         * \param hash        Hash code of the value
+         * \param value       Value to look for
+         * \param slot        Where a boolean flag indicating whether an entry
+         *                    was removed is assigned to
+         * \return            A boolean flag indicating whether the search was
+         *                    successfull or whether an exception was thrown
          */
-        bool Remove(i64 hash);
+        bool Remove(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& value,
+            bool& slot
+        );
 
         /**
          * Removes all entries from the set.
@@ -182,12 +216,29 @@ namespace tempearly
         void Mark();
 
     private:
-        /** Capacity of the hash table. */
-        const std::size_t m_bucket_size;
-        /** Hash table for fast lookup. */
-        Entry** m_bucket;
-        /** Number of entries stored in the set. */
-        std::size_t m_size;
+        /**
+         * Searches the hash table for an entry with given value. Values are
+         * compared only when their hash codes match. Index of the slot which
+         * contains the entry, or of the empty slot where such entry would be
+         * inserted, is assigned to <em>slot</em>.
+         *
+         * \return A boolean flag indicating whether the search was
+         *         successfull or whether an exception was thrown
+         */
+        bool FindSlot(
+            const Handle<Interpreter>& interpreter,
+            i64 hash,
+            const Handle<Object>& value,
+            std::size_t& slot
+        );
+
+        /**
+         * Doubles the capacity of the hash table.
+         */
+        void Grow();
+
+        /** Hash table for fast lookup, which is kept at most half full. */
+        HashTable<Entry*> m_bucket;
         /** Pointer to first entry. */
         Entry* m_front;
         /** Pointer to last entry. */
@@ -277,7 +277,7 @@ namespace tempearly
 
                 if (i > 0)
                 {
-                    buffer.Append(s.GetRunes(), i);
+                    buffer.Append(s.SubString(0, i));
                 }
                 for (std::size_t j = i; j < s.GetLength(); ++j)
                 {
@@ -457,7 +457,7 @@ namespace tempearly
 
                 if (i > 0)
                 {
-                    buffer.Append(s.GetRunes(), i);
+                    buffer.Append(s.SubString(0, i));
                 }
                 for (std::size_t j = i; j < s.GetLength(); ++j)
                 {
@@ -722,9 +722,11 @@ namespace tempearly
     /**
      * String#__hash__() => Int
      *
-     * Generates hash code from contents of the string.
+     * Generates hash code from contents of the string. Hash codes of strings
+     * are randomized for each process, so they should not be stored or sent
+     * elsewhere.
      *
-     *     "foo".__hash__() #=> 101574
+     *     "foo".__hash__() == ("f" + "oo").__hash__() #=> true
      */
     TEMPEARLY_NATIVE_METHOD(str_hash)
     {
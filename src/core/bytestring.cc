@@ -5,136 +5,135 @@
 
 namespace tempearly
 {
+    const std::size_t ByteString::npos = -1;
+
     ByteString::ByteString()
         : m_length(0)
-        , m_bytes(Memory::Allocate<byte>(1))
-        , m_counter(Memory::Allocate<unsigned int>(1))
     {
-        m_bytes[0] = 0;
-        m_counter[0] = 1;
+        m_inline_bytes[0] = 0;
     }
 
     ByteString::ByteString(const ByteString& that)
         : m_length(that.m_length)
-        , m_bytes(that.m_bytes)
-        , m_counter(that.m_counter)
     {
-        ++m_counter[0];
+        if (IsInline())
+        {
+            Memory::Copy<byte>(m_inline_bytes, that.m_inline_bytes, m_length + 1);
+        } else {
+            m_storage = that.m_storage;
+            ++m_storage.counter[0];
+        }
     }
 
     ByteString::ByteString(const char* input)
-        : m_length(std::strlen(input))
-        , m_bytes(Memory::Allocate<byte>(m_length + 1))
-        , m_counter(Memory::Allocate<unsigned int>(1))
     {
-        for (std::size_t i = 0; i < m_length; ++i)
-        {
-            m_bytes[i] = input[i];
-        }
-        m_bytes[m_length] = 0;
-        m_counter[0] = 1;
+        const std::size_t length = std::strlen(input);
+
+        Memory::Copy<byte>(Allocate(length), reinterpret_cast<const byte*>(input), length);
     }
 
     ByteString::ByteString(const byte* b, std::size_t n)
-        : m_length(n)
-        , m_bytes(Memory::Allocate<byte>(m_length + 1))
-        , m_counter(Memory::Allocate<unsigned int>(1))
     {
-        Memory::Copy<byte>(m_bytes, b, m_length);
-        m_bytes[m_length] = 0;
-        m_counter[0] = 1;
+        Memory::Copy<byte>(Allocate(n), b, n);
+    }
+
+    ByteString::ByteString(std::size_t length, byte*& bytes)
+    {
+        bytes = Allocate(length);
     }
 
     ByteString::~ByteString()
     {
-        if (--m_counter[0] == 0)
-        {
-            Memory::Unallocate<byte>(m_bytes);
-            Memory::Unallocate<unsigned int>(m_counter);
-        }
+        Release();
     }
 
-    ByteString& ByteString::Assign(const ByteString& that)
+    byte* ByteString::Allocate(std::size_t length)
     {
-        if (m_bytes != that.m_bytes)
+        unsigned int* counter;
+        byte* bytes;
+
+        if (length < sizeof(m_inline_bytes))
         {
-            if (--m_counter[0] == 0)
+            m_length = length;
+            bytes = m_inline_bytes;
+        } else {
+            // Byte data is placed right after the counter, so that both are
+            // allocated at once. Nothing is modified before the allocation
+            // has succeeded.
+            if (!(counter = reinterpret_cast<unsigned int*>(Memory::Allocate<byte>(sizeof(unsigned int) + length + 1))))
             {
-                Memory::Unallocate<byte>(m_bytes);
-                Memory::Unallocate<unsigned int>(m_counter);
+                throw std::bad_alloc();
             }
-            m_bytes = that.m_bytes;
-            m_counter = that.m_counter;
-            m_length = that.m_length;
-            ++m_counter[0];
+            counter[0] = 1;
+            m_length = length;
+            m_storage.counter = counter;
+            bytes = m_storage.bytes = reinterpret_cast<byte*>(counter + 1);
         }
+        bytes[length] = 0;
 
-        return *this;
+        return bytes;
     }
 
-    ByteString& ByteString::Assign(const char* input)
+    ByteString& ByteString::Assign(const ByteString& that)
     {
-        const std::size_t length = std::strlen(input);
-
-        if (--m_counter[0] == 0)
+        if (this == &that)
         {
-            if (m_length != length)
-            {
-                Memory::Unallocate<byte>(m_bytes);
-                m_bytes = Memory::Allocate<byte>(length + 1);
-            }
-        } else {
-            m_bytes = Memory::Allocate<byte>(length + 1);
-            m_counter = Memory::Allocate<unsigned int>(1);
+            return *this;
         }
-        m_length = length;
-        m_counter[0] = 1;
-        for (std::size_t i = 0; i < length; ++i)
+        else if (that.IsInline())
         {
-            m_bytes[i] = static_cast<byte>(input[i]);
+            Release();
+            m_length = that.m_length;
+            Memory::Copy<byte>(m_inline_bytes, that.m_inline_bytes, m_length + 1);
+        }
+        else if (IsInline() || m_storage.counter != that.m_storage.counter)
+        {
+            Release();
+            m_length = that.m_length;
+            m_storage = that.m_storage;
+            ++m_storage.counter[0];
+        } else {
+            m_length = that.m_length;
+            m_storage.bytes = that.m_storage.bytes;
         }
-        m_bytes[length] = 0;
 
         return *this;
     }
 
+    ByteString& ByteString::Assign(const char* input)
+    {
+        return Assign(ByteString(input));
+    }
+
     bool ByteString::Equals(const ByteString& that) const
     {
-        if (m_bytes == that.m_bytes)
-        {
-            return true;
-        }
-        else if (m_length != that.m_length)
+        if (m_length != that.m_length)
         {
             return false;
         }
-        for (std::size_t i = 0; i < m_length; ++i)
+        else if (!IsInline() && m_storage.bytes == that.m_storage.bytes)
         {
-            if (m_bytes[i] != that.m_bytes[i])
-            {
-                return false;
-            }
+            return true;
         }
 
-        return true;
+        return !std::memcmp(GetBytes(), that.GetBytes(), m_length);
     }
 
     int ByteString::Compare(const ByteString& that) const
     {
         const std::size_t n = m_length < that.m_length ? m_length : that.m_length;
+        const byte* a = GetBytes();
+        const byte* b = that.GetBytes();
 
-        if (m_bytes == that.m_bytes)
+        if (a == b)
         {
             return 0;
         }
         for (std::size_t i = 0; i < n; ++i)
         {
-            const byte a = m_bytes[i];
-            const byte b = that.m_bytes[i];
-
-            if (a != b)
+            if (a[i] != b[i])
             {
-                return a > b ? 1 : -1;
+                return a[i] > b[i] ? 1 : -1;
             }
         }
         if (m_length == that.m_length)
@@ -145,6 +144,31 @@ namespace tempearly
         }
     }
 
+    ByteString ByteString::SubString(std::size_t pos, std::size_t count) const
+    {
+        ByteString result;
+
+        if (pos >= m_length)
+        {
+            return result;
+        }
+        else if (count > m_length - pos)
+        {
+            count = m_length - pos;
+        }
+        if (count < sizeof(m_inline_bytes))
+        {
+            Memory::Copy<byte>(result.Allocate(count), GetBytes() + pos, count);
+        } else {
+            result.m_length = count;
+            result.m_storage.counter = m_storage.counter;
+            result.m_storage.bytes = m_storage.bytes + pos;
+            ++m_storage.counter[0];
+        }
+
+        return result;
+    }
+
     ByteString ByteString::Concat(const ByteString& that) const
     {
         if (m_length == 0)
@@ -156,13 +180,10 @@ namespace tempearly
             return *this;
         } else {
             ByteString result;
+            byte* bytes = result.Allocate(m_length + that.m_length);
 
-            result.m_length = m_length + that.m_length;
-            result.m_bytes = Memory::Allocate<byte>(result.m_length + 1);
-            result.m_counter = Memory::Allocate<unsigned int>(1);
-            result.m_counter[0] = 1;
-            Memory::Copy<byte>(result.m_bytes, m_bytes, m_length);
-            Memory::Copy<byte>(result.m_bytes + m_length, that.m_bytes, that.m_length);
+            Memory::Copy<byte>(bytes, GetBytes(), m_length);
+            Memory::Copy<byte>(bytes + m_length, that.GetBytes(), that.m_length);
 
             return result;
         }
@@ -6,12 +6,22 @@
 namespace tempearly
 {
     /**
-     * Immutable string like container for binary data. Ensured to be always
-     * null terminated to ensure it's with C functions and structs.
+     * Immutable string like container for binary data. Short byte strings are
+     * stored inside of the byte string object, while data of longer ones is
+     * allocated together with it's reference counter. Slices of longer byte
+     * strings share the data of the original one, so they can be taken
+     * without copying anything.
+     *
+     * Byte strings are null terminated, to ensure that they are compatible
+     * with C functions and structs, except slices which end before the end of
+     * the original byte string.
      */
     class ByteString
     {
     public:
+        /** Indicates no position. */
+        static const std::size_t npos;
+
         /**
          * Constructs empty byte string.
          */
@@ -39,6 +49,17 @@ namespace tempearly
          */
         ByteString(const byte* b, std::size_t n);
 
+        /**
+         * Constructs byte string of given length without initializing it's
+         * contents, so that the caller can write them directly into the
+         * storage instead of copying them from elsewhere.
+         *
+         * \param length Length of the byte string
+         * \param bytes  Receives pointer to the uninitialized byte data,
+         *               which must be filled before the byte string is used
+         */
+        ByteString(std::size_t length, byte*& bytes);
+
         /**
          * Destructor.
          */
@@ -95,7 +116,7 @@ namespace tempearly
          */
         inline byte GetFront() const
         {
-            return m_bytes[0];
+            return GetBytes()[0];
         }
 
         /**
@@ -103,7 +124,7 @@ namespace tempearly
          */
         inline byte GetBack() const
         {
-            return m_bytes[m_length - 1];
+            return GetBytes()[m_length - 1];
         }
 
         /**
@@ -111,7 +132,7 @@ namespace tempearly
          */
         inline byte At(std::size_t i) const
         {
-            return m_bytes[i];
+            return GetBytes()[i];
         }
 
         /**
@@ -119,7 +140,7 @@ namespace tempearly
          */
         inline byte operator[](std::size_t i) const
         {
-            return m_bytes[i];
+            return GetBytes()[i];
         }
 
         /**
@@ -127,17 +148,35 @@ namespace tempearly
          */
         inline const byte* GetBytes() const
         {
-            return m_bytes;
+            if (IsInline())
+            {
+                return m_inline_bytes;
+            }
+
+            return m_storage.bytes;
         }
 
         /**
-         * Returns C like string pointer to the byte data.
+         * Returns C like string pointer to the byte data. Should not be used
+         * on slices of other byte strings, which might not be null
+         * terminated.
          */
         inline const char* c_str() const
         {
-            return reinterpret_cast<const char*>(m_bytes);
+            return reinterpret_cast<const char*>(GetBytes());
         }
 
+        /**
+         * Returns a slice of the byte string. Slices which are not short
+         * enough to be stored inside of the byte string object share the
+         * data of this byte string instead of copying it.
+         *
+         * \param pos   Index of the first byte of the slice
+         * \param count Number of bytes in the slice, or npos for all bytes
+         *              until the end of the byte string
+         */
+        ByteString SubString(std::size_t pos = 0, std::size_t count = npos) const;
+
         /**
          * Tests whether contents of two byte strings are equal.
          *
@@ -219,12 +258,58 @@ namespace tempearly
         Handle<Stream> AsStream() const;
 
     private:
+        /**
+         * Location of byte data which is stored outside of the byte string
+         * object.
+         */
+        struct Storage
+        {
+            /**
+             * Counter used for tracking usage of the data, followed by the
+             * byte data itself in the same allocation.
+             */
+            unsigned int* counter;
+            /** Pointer to the first byte of the byte string. */
+            byte* bytes;
+        };
+
+        /**
+         * Returns true if the byte data is stored inside of the object.
+         */
+        inline bool IsInline() const
+        {
+            return m_length < sizeof(m_inline_bytes);
+        }
+
+        /**
+         * Allocates storage for given number of bytes and null terminates
+         * it. Previous contents of the binary string are not released.
+         *
+         * \return Pointer to the allocated byte data
+         */
+        byte* Allocate(std::size_t length);
+
+        /**
+         * Releases the byte data, if it's no longer used by any other binary
+         * string.
+         */
+        inline void Release()
+        {
+            if (!IsInline() && --m_storage.counter[0] == 0)
+            {
+                Memory::Unallocate<unsigned int>(m_storage.counter);
+            }
+        }
+
         /** Length of the binary string. */
         std::size_t m_length;
-        /** Pointer to the byte data. */
-        byte* m_bytes;
-        /** Counter used for tracking usage of the data. */
-        unsigned int* m_counter;
+        union
+        {
+            /** Byte data stored outside of the byte string object. */
+            Storage m_storage;
+            /** Byte data of short binary strings, including the terminator. */
+            byte m_inline_bytes[sizeof(Storage)];
+        };
     };
 }
 
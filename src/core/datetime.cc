@@ -126,7 +126,7 @@ namespace tempearly
 
                     if (year.GetLength() >= 2)
                     {
-                        result.Append(year.GetRunes() + year.GetLength() - 2, 2);
+                        result.Append(year.SubString(year.GetLength() - 2));
                     } else {
                         result << '0' << year;
                     }
@@ -140,7 +140,7 @@ namespace tempearly
 
                     if (year.GetLength() >= 2)
                     {
-                        result.Append(year.GetRunes(), 2);
+                        result.Append(year.SubString(0, 2));
                     } else {
                         result << '0' << year;
                     }
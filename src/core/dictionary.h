@@ -1,18 +1,27 @@
 #ifndef TEMPEARLY_CORE_DICTIONARY_H_GUARD
 #define TEMPEARLY_CORE_DICTIONARY_H_GUARD
 
+#include "core/hashtable.h"
 #include "core/string.h"
 
 namespace tempearly
 {
     /**
      * Hash map implementation which uses strings as keys.
+     *
+     * Entries are stored in a single array in insertion order, and looked up
+     * through a separate open addressing hash table which contains positions
+     * of the entries in that array. Both are grown as entries are inserted,
+     * so lookups stay constant time regardless of the number of entries.
+     * Inserting new entries might move existing ones, which invalidates
+     * pointers to them.
      */
     template< class T >
     class Dictionary
     {
     public:
-        static const std::size_t kBucketSize = 8;
+        /** Number of entries which fit into a newly allocated dictionary. */
+        static const std::size_t kMinimumCapacity = 8;
 
         /**
          * Represents single key-value pair stored in the dictionary. Can also
@@ -99,8 +108,7 @@ namespace tempearly
                 , m_name(name)
                 , m_value(value)
                 , m_next(nullptr)
-                , m_previous(nullptr)
-                , m_child(nullptr) {}
+                , m_previous(nullptr) {}
 
             /** Cached hash code of the entry. */
             std::size_t m_hash_code;
@@ -112,54 +120,38 @@ namespace tempearly
             Entry* m_next;
             /** Pointer to previous entry in the dictionary. */
             Entry* m_previous;
-            /** Pointer next entry in hash table. */
-            Entry* m_child;
             friend class Dictionary;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Entry);
         };
 
         /**
-         * Constructs empty dictionary.
+         * Constructs empty dictionary. Nothing is allocated until the first
+         * entry is inserted.
          */
         Dictionary()
-            : m_bucket(Memory::Allocate<Entry*>(kBucketSize))
+            : m_entries(nullptr)
+            , m_capacity(0)
+            , m_used(0)
+            , m_size(0)
             , m_front(nullptr)
-            , m_back(nullptr)
-        {
-            for (std::size_t i = 0; i < kBucketSize; ++i)
-            {
-                m_bucket[i] = nullptr;
-            }
-        }
+            , m_back(nullptr) {}
 
         /**
          * Copy constructor. Constructs dictionary from values taken from
          * another dictionary.
          */
         Dictionary(const Dictionary<T>& that)
-            : m_bucket(Memory::Allocate<Entry*>(kBucketSize))
+            : m_entries(nullptr)
+            , m_capacity(0)
+            , m_used(0)
+            , m_size(0)
             , m_front(nullptr)
             , m_back(nullptr)
         {
-            for (std::size_t i = 0; i < kBucketSize; ++i)
+            Reserve(that.m_size);
+            for (const Entry* entry = that.m_front; entry; entry = entry->m_next)
             {
-                m_bucket[i] = nullptr;
-            }
-            for (const Entry* entry1 = that.m_front; entry1; entry1 = entry1->m_next)
-            {
-                Entry* entry2 = new Entry(entry1->m_hash_code, entry1->m_name, entry1->m_value);
-                const std::size_t index = entry1->m_hash_code % kBucketSize;
-
-                entry2->m_next = nullptr;
-                if ((entry2->m_previous = m_back))
-                {
-                    m_back->m_next = entry2;
-                } else {
-                    m_front = entry2;
-                }
-                m_back = entry2;
-                entry2->m_child = m_bucket[index];
-                m_bucket[index] = entry2;
+                Append(entry->m_hash_code, entry->m_name, entry->m_value);
             }
         }
 
@@ -169,35 +161,19 @@ namespace tempearly
          */
         template< class U >
         Dictionary(const Dictionary<U>& that)
-            : m_bucket(Memory::Allocate<Entry*>(kBucketSize))
+            : m_entries(nullptr)
+            , m_capacity(0)
+            , m_used(0)
+            , m_size(0)
             , m_front(nullptr)
             , m_back(nullptr)
         {
-            for (std::size_t i = 0; i < kBucketSize; ++i)
+            Reserve(that.GetSize());
+            for (const typename Dictionary<U>::Entry* entry = that.GetFront();
+                 entry;
+                 entry = entry->GetNext())
             {
-                m_bucket[i] = nullptr;
-            }
-            for (const typename Dictionary<U>::Entry* entry1 = that.GetFront();
-                 entry1;
-                 entry1 = entry1->GetNext())
-            {
-                Entry* entry2 = new Entry(
-                    entry1->GetHashCode(),
-                    entry1->GetName(),
-                    entry1->GetValue()
-                );
-                const std::size_t index = entry1->GetHashCode() % kBucketSize;
-
-                entry2->m_next = nullptr;
-                if ((entry2->m_previous = m_back))
-                {
-                    m_back->m_next = entry2;
-                } else {
-                    m_front = entry2;
-                }
-                m_back = entry2;
-                entry2->m_child = m_bucket[index];
-                m_bucket[index] = entry2;
+                Append(entry->GetHashCode(), entry->GetName(), entry->GetValue());
             }
         }
 
@@ -206,11 +182,16 @@ namespace tempearly
          * one and the original becomes unusable after that.
          */
         Dictionary(Dictionary<T>&& that)
-            : m_bucket(that.m_bucket)
+            : m_entries(that.m_entries)
+            , m_capacity(that.m_capacity)
+            , m_used(that.m_used)
+            , m_size(that.m_size)
             , m_front(that.m_front)
             , m_back(that.m_back)
         {
-            that.m_bucket = nullptr;
+            m_index.Swap(that.m_index);
+            that.m_entries = nullptr;
+            that.m_capacity = that.m_used = that.m_size = 0;
             that.m_front = that.m_back = nullptr;
         }
 
@@ -219,16 +200,7 @@ namespace tempearly
          */
         virtual ~Dictionary()
         {
-            Entry* current = m_front;
-            Entry* next;
-
-            while (current)
-            {
-                next = current->m_next;
-                delete current;
-                current = next;
-            }
-            Memory::Unallocate<Entry*>(m_bucket);
+            Destroy(m_front, m_entries);
         }
 
         /**
@@ -236,22 +208,14 @@ namespace tempearly
          */
         Dictionary& Assign(const Dictionary<T>& that)
         {
-            Clear();
-            for (const Entry* entry1 = that.m_front; entry1; entry1 = entry1->m_next)
+            if (this != &that)
             {
-                Entry* entry2 = new Entry(entry1->m_hash_code, entry1->m_name, entry1->m_value);
-                const std::size_t index = entry1->m_hash_code % kBucketSize;
-
-                entry2->m_next = nullptr;
-                if ((entry2->m_previous = m_back))
+                Clear();
+                Reserve(that.m_size);
+                for (const Entry* entry = that.m_front; entry; entry = entry->m_next)
                 {
-                    m_back->m_next = entry2;
-                } else {
-                    m_front = entry2;
+                    Append(entry->m_hash_code, entry->m_name, entry->m_value);
                 }
-                m_back = entry2;
-                entry2->m_child = m_bucket[index];
-                m_bucket[index] = entry2;
             }
 
             return *this;
@@ -264,23 +228,12 @@ namespace tempearly
         Dictionary& Assign(const Dictionary<U>& that)
         {
             Clear();
-            for (const typename Dictionary<U>::Entry* entry1 = that.GetFront();
-                 entry1;
-                 entry1 = entry1->m_next)
+            Reserve(that.GetSize());
+            for (const typename Dictionary<U>::Entry* entry = that.GetFront();
+                 entry;
+                 entry = entry->GetNext())
             {
-                Entry* entry2 = new Entry(entry1->m_hash_code, entry1->m_name, entry1->m_value);
-                const std::size_t index = entry1->m_hash_code % kBucketSize;
-
-                entry2->m_next = nullptr;
-                if ((entry2->m_previous = m_back))
-                {
-                    m_back->m_next = entry2;
-                } else {
-                    m_front = entry2;
-                }
-                m_back = entry2;
-                entry2->m_child = m_bucket[index];
-                m_bucket[index] = entry2;
+                Append(entry->GetHashCode(), entry->GetName(), entry->GetValue());
             }
 
             return *this;
@@ -308,20 +261,21 @@ namespace tempearly
          */
         Dictionary& operator=(Dictionary<T>&& that)
         {
-            Entry* current = m_front;
-            Entry* next;
-
-            while (current)
+            if (this == &that)
             {
-                next = current->m_next;
-                delete current;
-                current = next;
+                return *this;
             }
-            Memory::Unallocate<Entry*>(m_bucket);
-            m_bucket = that.m_bucket;
+            Destroy(m_front, m_entries);
+            m_index.Reset(0);
+            m_index.Swap(that.m_index);
+            m_entries = that.m_entries;
+            m_capacity = that.m_capacity;
+            m_used = that.m_used;
+            m_size = that.m_size;
             m_front = that.m_front;
             m_back = that.m_back;
-            that.m_bucket = nullptr;
+            that.m_entries = nullptr;
+            that.m_capacity = that.m_used = that.m_size = 0;
             that.m_front = that.m_back = nullptr;
 
             return *this;
@@ -332,7 +286,15 @@ namespace tempearly
          */
         inline bool IsEmpty() const
         {
-            return !m_front;
+            return !m_size;
+        }
+
+        /**
+         * Returns number of entries in the dictionary.
+         */
+        inline std::size_t GetSize() const
+        {
+            return m_size;
         }
 
         /**
@@ -374,45 +336,31 @@ namespace tempearly
         /**
          * Searches for an value with given identifier. Returns pointer to the
          * entry holding the value, if such exists. Otherwise NULL is returned.
+         * The pointer remains valid until another entry is inserted into the
+         * dictionary.
          *
          * \param id Identifier to look for
          */
         Entry* Find(const String& id)
         {
-            const std::size_t hash = id.HashCode();
-            const std::size_t index = hash % kBucketSize;
-
-            for (Entry* entry = m_bucket[index]; entry; entry = entry->m_child)
-            {
-                if (entry->m_hash_code == hash)
-                {
-                    return entry;
-                }
-            }
+            const std::size_t slot = FindSlot(id, id.HashCode());
 
-            return nullptr;
+            return slot == npos ? nullptr : m_entries + m_index[slot] - 1;
         }
 
         /**
          * Searches for an value with given identifier. Returns pointer to the
          * entry holding the value, if such exists. Otherwise NULL is returned.
+         * The pointer remains valid until another entry is inserted into the
+         * dictionary.
          *
          * \param id Identifier to look for
          */
         const Entry* Find(const String& id) const
         {
-            const std::size_t hash = id.HashCode();
-            const std::size_t index = hash % kBucketSize;
+            const std::size_t slot = FindSlot(id, id.HashCode());
 
-            for (const Entry* entry = m_bucket[index]; entry; entry = entry->m_child)
-            {
-                if (entry->m_hash_code == hash)
-                {
-                    return entry;
-                }
-            }
-
-            return nullptr;
+            return slot == npos ? nullptr : m_entries + m_index[slot] - 1;
         }
 
         /**
@@ -425,48 +373,43 @@ namespace tempearly
         void Insert(const String& id, const T& value)
         {
             const std::size_t hash = id.HashCode();
-            const std::size_t index = hash % kBucketSize;
-            Entry* entry;
+            const std::size_t slot = FindSlot(id, hash);
 
-            for (entry = m_bucket[index]; entry; entry = entry->m_child)
+            if (slot == npos)
             {
-                if (entry->m_hash_code == hash)
-                {
-                    entry->m_value = value;
-                    return;
-                }
-            }
-            entry = new Entry(hash, id, value);
-            entry->m_next = nullptr;
-            if ((entry->m_previous = m_back))
-            {
-                m_back->m_next = entry;
+                Append(hash, id, value);
             } else {
-                m_front = entry;
+                m_entries[m_index[slot] - 1].m_value = value;
             }
-            m_back = entry;
-            entry->m_child = m_bucket[index];
-            m_bucket[index] = entry;
         }
 
         /**
-         * Removes all entries from the dictionary.
+         * Ensures that the dictionary has room for at least <i>n</i> entries
+         * without having to grow.
          */
-        void Clear()
+        void Reserve(std::size_t n)
         {
-            Entry* current = m_front;
-            Entry* next;
-
-            for (std::size_t i = 0; i < kBucketSize; ++i)
+            if (n > m_capacity - m_used + m_size)
             {
-                m_bucket[i] = nullptr;
+                Entry* front = m_front;
+
+                Destroy(front, Relocate(n));
             }
-            while (current)
+        }
+
+        /**
+         * Removes all entries from the dictionary. Allocated memory is kept
+         * for reuse.
+         */
+        void Clear()
+        {
+            for (Entry* current = m_front, *next; current; current = next)
             {
                 next = current->m_next;
-                delete current;
-                current = next;
+                current->~Entry();
             }
+            m_index.Clear();
+            m_used = m_size = 0;
             m_front = m_back = nullptr;
         }
 
@@ -477,70 +420,222 @@ namespace tempearly
          */
         void Erase(const String& id)
         {
-            const std::size_t hash = id.HashCode();
-            const std::size_t index = hash % kBucketSize;
-            Entry* entry = m_bucket[index];
+            const std::size_t slot = FindSlot(id, id.HashCode());
+            Entry* entry;
 
-            if (!entry)
+            if (slot == npos)
             {
                 return;
             }
-            if (entry->m_hash_code == hash)
+            entry = m_entries + m_index[slot] - 1;
+            if (entry->m_next)
             {
-                m_bucket[index] = entry->m_child;
-                if (entry->m_next && entry->m_previous)
-                {
-                    entry->m_next->m_previous = entry->m_previous;
-                    entry->m_previous->m_next = entry->m_next;
-                }
-                else if (entry->m_next)
-                {
-                    entry->m_next->m_previous = nullptr;
-                    m_front = entry->m_next;
-                }
-                else if (entry->m_previous)
+                entry->m_next->m_previous = entry->m_previous;
+            } else {
+                m_back = entry->m_previous;
+            }
+            if (entry->m_previous)
+            {
+                entry->m_previous->m_next = entry->m_next;
+            } else {
+                m_front = entry->m_next;
+            }
+            // The position of the entry is left unused until the entries are
+            // relocated.
+            entry->~Entry();
+            --m_size;
+            m_index.Erase(slot, PositionHash(m_entries));
+        }
+
+    private:
+        /** Indicates that no slot was found from the hash table. */
+        static const std::size_t npos = static_cast<std::size_t>(-1);
+
+        /**
+         * Function object which compares entries referred by the hash table
+         * against an identifier.
+         */
+        class NameMatcher
+        {
+        public:
+            explicit NameMatcher(const Entry* entries, const String& id, std::size_t hash)
+                : m_entries(entries)
+                , m_id(id)
+                , m_hash(hash) {}
+
+            inline bool operator()(u32 position, bool& equal) const
+            {
+                const Entry& entry = m_entries[position - 1];
+
+                equal = entry.GetHashCode() == m_hash && entry.GetName().Equals(m_id);
+
+                return true;
+            }
+
+        private:
+            /** Entry array of the dictionary. */
+            const Entry* m_entries;
+            /** Identifier to look for. */
+            const String& m_id;
+            /** Hash code of the identifier. */
+            const std::size_t m_hash;
+        };
+
+        /**
+         * Function object which returns hash code of an entry referred by the
+         * hash table.
+         */
+        class PositionHash
+        {
+        public:
+            explicit PositionHash(const Entry* entries)
+                : m_entries(entries) {}
+
+            inline u64 operator()(u32 position) const
+            {
+                return m_entries[position - 1].GetHashCode();
+            }
+
+        private:
+            /** Entry array of the dictionary. */
+            const Entry* m_entries;
+        };
+
+        /**
+         * Returns index of the hash table slot which refers to an entry with
+         * given identifier, or npos if there is no such entry. Identifiers
+         * are compared only when the hash codes match.
+         */
+        std::size_t FindSlot(const String& id, std::size_t hash) const
+        {
+            NameMatcher matcher(m_entries, id, hash);
+            std::size_t slot;
+
+            if (!m_size)
+            {
+                return npos;
+            }
+            m_index.Find(hash, matcher, slot);
+
+            return m_index[slot] ? slot : npos;
+        }
+
+        /**
+         * Inserts an entry into the hash table, which must not contain an
+         * entry with the same identifier already.
+         */
+        void InsertSlot(std::size_t hash, std::size_t position)
+        {
+            m_index.Insert(m_index.FindEmptySlot(hash), static_cast<u32>(position + 1));
+        }
+
+        /**
+         * Appends new entry to the end of the dictionary, which must not
+         * contain an entry with the same identifier already.
+         */
+        void Append(std::size_t hash, const String& name, const T& value)
+        {
+            Entry* old_front = m_front;
+            Entry* old = nullptr;
+            Entry* entry;
+
+            // The name or the value might belong to one of the existing
+            // entries, so those are destroyed only after the new entry has
+            // been constructed.
+            if (m_used >= m_capacity)
+            {
+                old = Relocate(m_size + 1);
+            }
+            entry = new (static_cast<void*>(m_entries + m_used)) Entry(hash, name, value);
+            if ((entry->m_previous = m_back))
+            {
+                m_back->m_next = entry;
+            } else {
+                m_front = entry;
+            }
+            m_back = entry;
+            InsertSlot(hash, m_used++);
+            ++m_size;
+            if (old)
+            {
+                Destroy(old_front, old);
+            }
+        }
+
+        /**
+         * Copies the entries into newly allocated entry array and hash table,
+         * which have room for at least <i>n</i> entries. Positions left
+         * unused by removed entries are reclaimed in the process. The hash
+         * table is kept at most half full.
+         *
+         * \return Previous entry array, which still contains the original
+         *         entries
+         */
+        Entry* Relocate(std::size_t n)
+        {
+            Entry* old = m_entries;
+            Entry* previous = nullptr;
+
+            m_capacity = kMinimumCapacity;
+            while (m_capacity < n || m_capacity < m_size * 2)
+            {
+                m_capacity *= 2;
+            }
+            m_entries = Memory::Allocate<Entry>(m_capacity);
+            m_index.Reset(m_capacity * 2);
+            m_used = 0;
+            for (const Entry* current = m_front; current; current = current->m_next)
+            {
+                Entry* entry = new (static_cast<void*>(m_entries + m_used)) Entry(
+                    current->m_hash_code,
+                    current->m_name,
+                    current->m_value
+                );
+
+                if ((entry->m_previous = previous))
                 {
-                    entry->m_previous->m_next = nullptr;
-                    m_back = entry->m_previous;
+                    previous->m_next = entry;
                 } else {
-                    m_front = m_back = nullptr;
+                    m_front = entry;
                 }
-                delete entry;
-                return;
+                previous = entry;
+                InsertSlot(entry->m_hash_code, m_used++);
             }
-            for (; entry->m_child; entry = entry->m_child)
+            m_back = previous;
+
+            return old;
+        }
+
+        /**
+         * Destroys linked entries beginning from given one and unallocates
+         * the entry array which contains them.
+         */
+        static void Destroy(Entry* front, Entry* entries)
+        {
+            Entry* next;
+
+            for (; front; front = next)
             {
-                if (entry->m_child->m_hash_code == hash)
-                {
-                    Entry* child = entry->m_child;
-
-                    entry->m_child = entry->m_child->m_child;
-                    if (child->m_next && child->m_previous)
-                    {
-                        child->m_next->m_previous = child->m_previous;
-                        child->m_previous->m_next = child->m_next;
-                    }
-                    else if (child->m_next)
-                    {
-                        child->m_next->m_previous = nullptr;
-                        m_front = child->m_next;
-                    }
-                    else if (child->m_previous)
-                    {
-                        child->m_previous->m_next = nullptr;
-                        m_back = child->m_previous;
-                    } else {
-                        m_front = m_back = nullptr;
-                    }
-                    delete child;
-                    return;
-                }
+                next = front->m_next;
+                front->~Entry();
             }
+            Memory::Unallocate<Entry>(entries);
         }
 
-    private:
-        /** The actual hash table. */
-        Entry** m_bucket;
+        /** Entries of the dictionary in insertion order. */
+        Entry* m_entries;
+        /**
+         * Open addressing hash table with twice as many slots as there is
+         * room for entries. Each used slot contains position of an entry in
+         * the entry array plus one, while unused slots contain zero.
+         */
+        HashTable<u32> m_index;
+        /** Number of entries which fit into the entry array. */
+        std::size_t m_capacity;
+        /** Number of positions taken from the entry array. */
+        std::size_t m_used;
+        /** Number of entries in the dictionary. */
+        std::size_t m_size;
         /** Pointer to the first entry in the dictionary. */
         Entry* m_front;
         /** Pointer to the last entry in the dictionary. */
@@ -295,7 +295,7 @@ namespace tempearly
                 if (m_handle >= 0)
                 {
                     ::close(m_handle);
-                    m_handle = 0;
+                    m_handle = -1;
                 }
             }
 
@@ -0,0 +1,241 @@
+#ifndef TEMPEARLY_CORE_HASHTABLE_H_GUARD
+#define TEMPEARLY_CORE_HASHTABLE_H_GUARD
+
+#include "memory.h"
+
+namespace tempearly
+{
+    /**
+     * Open addressing hash table with linear probing, used as the lookup
+     * index of hash based containers. Slots contain values of type T, such
+     * as pointers to entries or positions of entries, and a value initialized
+     * T marks an unused slot. The table does not know hash codes of the
+     * values it contains, so operations which need them take a function
+     * object which returns the hash code of given value. Size of the table
+     * is always a power of two.
+     */
+    template< class T >
+    class HashTable
+    {
+    public:
+        /**
+         * Constructs hash table with given number of slots, which must be
+         * either zero or a power of two. Nothing is allocated for a table
+         * without slots.
+         */
+        explicit HashTable(std::size_t size = 0)
+            : m_slots(nullptr)
+            , m_size(0)
+            , m_count(0)
+        {
+            Reset(size);
+        }
+
+        /**
+         * Destructor.
+         */
+        ~HashTable()
+        {
+            Memory::Unallocate<T>(m_slots);
+        }
+
+        /**
+         * Returns number of slots in the table.
+         */
+        inline std::size_t GetSize() const
+        {
+            return m_size;
+        }
+
+        /**
+         * Returns number of used slots in the table.
+         */
+        inline std::size_t GetCount() const
+        {
+            return m_count;
+        }
+
+        /**
+         * Returns value of given slot.
+         */
+        inline const T& operator[](std::size_t slot) const
+        {
+            return m_slots[slot];
+        }
+
+        /**
+         * Returns the slot where the probe sequence of given hash code
+         * begins. Hash codes are scrambled first, because the hash codes of
+         * integers and other simple values tend to follow regular patterns.
+         */
+        inline std::size_t GetHomeSlot(u64 hash) const
+        {
+            const u64 h = hash * 0x9e3779b97f4a7c15ULL;
+
+            return static_cast<std::size_t>(h ^ (h >> 32)) & (m_size - 1);
+        }
+
+        /**
+         * Searches the probe sequence of given hash code for a value which is
+         * accepted by given matcher. The matcher is invoked as
+         * <code>matcher(value, equal)</code> for each value in the sequence
+         * and returns false if the comparison failed. If the table is
+         * modified while the matcher runs, the search is started over.
+         *
+         * \param hash    Hash code to search for
+         * \param matcher Function object which compares values of the table
+         * \param slot    Where index of the slot which contains the matching
+         *                value, or of the empty slot which ends the probe
+         *                sequence, is assigned to
+         * \return        A boolean flag indicating whether the search was
+         *                successfull or whether the matcher failed
+         */
+        template< class Matcher >
+        bool Find(u64 hash, Matcher& matcher, std::size_t& slot) const
+        {
+            for (;;)
+            {
+                const T* slots = m_slots;
+                const std::size_t size = m_size;
+                const std::size_t count = m_count;
+                std::size_t index = GetHomeSlot(hash);
+                bool modified = false;
+
+                for (; m_slots[index] != T(); index = (index + 1) & (size - 1))
+                {
+                    const T value = m_slots[index];
+                    bool equal;
+
+                    if (!matcher(value, equal))
+                    {
+                        return false;
+                    }
+                    else if (m_slots != slots
+                            || m_size != size
+                            || m_count != count
+                            || m_slots[index] != value)
+                    {
+                        modified = true;
+                        break;
+                    }
+                    else if (equal)
+                    {
+                        break;
+                    }
+                }
+                if (!modified)
+                {
+                    slot = index;
+
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * Returns index of the first empty slot in the probe sequence of
+         * given hash code.
+         */
+        std::size_t FindEmptySlot(u64 hash) const
+        {
+            const std::size_t mask = m_size - 1;
+            std::size_t index = GetHomeSlot(hash);
+
+            while (m_slots[index] != T())
+            {
+                index = (index + 1) & mask;
+            }
+
+            return index;
+        }
+
+        /**
+         * Stores given value into given empty slot.
+         */
+        inline void Insert(std::size_t slot, const T& value)
+        {
+            m_slots[slot] = value;
+            ++m_count;
+        }
+
+        /**
+         * Removes value from given slot. Following values of the same probe
+         * sequence are shifted back, so that lookups never have to skip over
+         * removed values.
+         *
+         * \param slot    Index of the slot to empty
+         * \param hash_of Function object which returns hash code of given
+         *                value of the table
+         */
+        template< class HashOf >
+        void Erase(std::size_t slot, const HashOf& hash_of)
+        {
+            const std::size_t mask = m_size - 1;
+
+            for (std::size_t i = (slot + 1) & mask; m_slots[i] != T(); i = (i + 1) & mask)
+            {
+                const std::size_t home = GetHomeSlot(hash_of(m_slots[i]));
+
+                if (((i - home) & mask) >= ((i - slot) & mask))
+                {
+                    m_slots[slot] = m_slots[i];
+                    slot = i;
+                }
+            }
+            m_slots[slot] = T();
+            --m_count;
+        }
+
+        /**
+         * Empties every slot of the table.
+         */
+        void Clear()
+        {
+            for (std::size_t i = 0; i < m_size; ++i)
+            {
+                m_slots[i] = T();
+            }
+            m_count = 0;
+        }
+
+        /**
+         * Replaces the table with an empty one which has given number of
+         * slots. Values stored in the table are discarded.
+         */
+        void Reset(std::size_t size)
+        {
+            Memory::Unallocate<T>(m_slots);
+            m_slots = size ? Memory::Allocate<T>(size) : nullptr;
+            m_size = size;
+            Clear();
+        }
+
+        /**
+         * Exchanges contents of this table with another one.
+         */
+        void Swap(HashTable<T>& that)
+        {
+            T* slots = m_slots;
+            const std::size_t size = m_size;
+            const std::size_t count = m_count;
+
+            m_slots = that.m_slots;
+            m_size = that.m_size;
+            m_count = that.m_count;
+            that.m_slots = slots;
+            that.m_size = size;
+            that.m_count = count;
+        }
+
+    private:
+        /** The slots. */
+        T* m_slots;
+        /** Number of slots. */
+        std::size_t m_size;
+        /** Number of used slots. */
+        std::size_t m_count;
+        TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(HashTable);
+    };
+}
+
+#endif /* !TEMPEARLY_CORE_HASHTABLE_H_GUARD */
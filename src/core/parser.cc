@@ -3,16 +3,29 @@
 
 namespace tempearly
 {
+    /** Number of runes decoded from the stream at once. */
+    static const std::size_t kBufferSize = 1024;
+
     Parser::Parser(const Handle<Stream>& stream)
         : m_stream(stream.Get())
-        , m_seen_cr(false) {}
+        , m_buffer(Memory::Allocate<rune>(kBufferSize))
+        , m_offset(0)
+        , m_remain(0)
+        , m_seen_cr(false)
+    {
+        m_position.line = 1;
+        m_position.column = 0;
+    }
 
     Parser::~Parser()
     {
-        if (m_stream)
+        // The stream might already have been destroyed by the garbage
+        // collector if both are being finalized at the same time.
+        if (m_stream && !m_stream->HasFlag(CountedObject::FLAG_FINALIZING))
         {
             m_stream->Close();
         }
+        Memory::Unallocate<rune>(m_buffer);
     }
 
     void Parser::Close()
@@ -22,6 +35,7 @@ namespace tempearly
             m_stream->Close();
             m_stream = nullptr;
         }
+        m_remain = 0;
     }
 
     int Parser::PeekRune()
@@ -49,6 +63,8 @@ namespace tempearly
 
     int Parser::ReadRune()
     {
+        rune slot;
+
         if (!m_pushback_runes.IsEmpty())
         {
             int r = m_pushback_runes.GetFront();
@@ -57,48 +73,55 @@ namespace tempearly
 
             return r;
         }
-        if (m_stream)
+        if (!m_remain)
         {
-            rune slot;
-            Stream::ReadResult result = m_stream->ReadRune(slot);
+            Stream::ReadResult result;
 
+            if (!m_stream)
+            {
+                return -1;
+            }
+            // Malformed sequences are decoded as U+FFFD.
+            result = m_stream->ReadRunes(m_buffer, kBufferSize, m_remain);
             if (result != Stream::SUCCESS && result != Stream::DECODING_ERROR)
             {
                 m_stream->Close();
                 m_stream = nullptr;
+                m_remain = 0;
 
                 return -1;
             }
-            switch (slot)
-            {
-                case '\r':
+            m_offset = 0;
+        }
+        slot = m_buffer[m_offset++];
+        --m_remain;
+        switch (slot)
+        {
+            case '\r':
+                ++m_position.line;
+                m_position.column = 0;
+                m_seen_cr = true;
+                break;
+
+            case '\n':
+                if (m_seen_cr)
+                {
+                    m_seen_cr = false;
+                } else {
                     ++m_position.line;
                     m_position.column = 0;
-                    m_seen_cr = true;
-                    break;
-
-                case '\n':
-                    if (m_seen_cr)
-                    {
-                        m_seen_cr = false;
-                    } else {
-                        ++m_position.line;
-                        m_position.column = 0;
-                    }
-                    break;
-
-                default:
-                    ++m_position.column;
-                    if (m_seen_cr)
-                    {
-                        m_seen_cr = false;
-                    }
-            }
-
-            return slot;
+                }
+                break;
+
+            default:
+                ++m_position.column;
+                if (m_seen_cr)
+                {
+                    m_seen_cr = false;
+                }
         }
 
-        return -1;
+        return slot;
     }
 
     bool Parser::ReadRune(rune expected)
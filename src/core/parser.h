@@ -70,6 +70,12 @@ namespace tempearly
     private:
         /** Stream where the input is read from. */
         Stream* m_stream;
+        /** Runes decoded from the stream in advance. */
+        rune* m_buffer;
+        /** Current offset of the buffer. */
+        std::size_t m_offset;
+        /** How many runes are still unread from the buffer. */
+        std::size_t m_remain;
         Vector<rune> m_pushback_runes;
         /** Current position in source code. */
         Position m_position;
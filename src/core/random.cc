@@ -33,9 +33,10 @@ namespace tempearly
     static const int n = 624;
     static const int m = 397;
 
-    static bool initialized = false;
-    static u64 state[n] = {0x0};
-    static std::size_t offset = 0;
+    // Each thread uses a generator of it's own.
+    static thread_local bool initialized = false;
+    static thread_local u64 state[n] = {0x0};
+    static thread_local std::size_t offset = 0;
 
     static void seed(u64);
     static void gen_state();
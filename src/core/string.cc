@@ -1,9 +1,13 @@
 #include <cctype>
 #include <cfloat>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 
 #include "core/bytestring.h"
 #include "core/stringbuilder.h"
+#include "core/utf8.h"
 #include "core/vector.h"
 
 #if defined(TEMPEARLY_HAVE_CLIMITS)
@@ -20,208 +24,174 @@
 # endif
 #endif
 
+#if defined(TEMPEARLY_HAVE_EMMINTRIN_H) && (defined(__SSE2__) || defined(_M_X64))
+# include <emmintrin.h>
+# define TEMPEARLY_STRING_SSE2 1
+#endif
+
 namespace tempearly
 {
     static const char digitmap[] = "0123456789abcdefghijklmnopqrstuvwxyz";
 
     const std::size_t String::npos = -1;
 
+    /**
+     * Minimum length of concatenated strings which are allocated with spare
+     * capacity.
+     */
+    static const std::size_t kConcatSpareLimit = 16;
+
     String::String()
         : m_offset(0)
         , m_length(0)
-        , m_runes(nullptr)
-        , m_counter(nullptr)
-        , m_hash_code(0) {}
+        , m_hash_code(0)
+        , m_ascii(true)
+        , m_inline(true) {}
 
     String::String(const String& that)
         : m_offset(that.m_offset)
         , m_length(that.m_length)
-        , m_runes(that.m_runes)
-        , m_counter(that.m_counter)
         , m_hash_code(that.m_hash_code)
+        , m_ascii(that.m_ascii)
+        , m_inline(that.m_inline)
     {
-        if (m_counter)
+        if (m_inline)
         {
-            ++(*m_counter);
+            CopyInline(that);
+        } else {
+            m_storage = that.m_storage;
+            ++m_storage.counter->references;
         }
     }
 
     String::String(String&& that)
         : m_offset(that.m_offset)
         , m_length(that.m_length)
-        , m_runes(that.m_runes)
-        , m_counter(that.m_counter)
         , m_hash_code(that.m_hash_code)
+        , m_ascii(that.m_ascii)
+        , m_inline(that.m_inline)
     {
-        that.m_offset = that.m_length = that.m_hash_code = 0;
-        that.m_runes = nullptr;
-        that.m_counter = nullptr;
-    }
-
-    static inline std::size_t utf8_size(unsigned char input)
-    {
-        if ((input & 0x80) == 0x00)
-        {
-            return 1;
-        }
-        else if ((input & 0xc0) == 0x80)
-        {
-            return 0;
-        }
-        else if ((input & 0xe0) == 0xc0)
-        {
-            return 2;
-        }
-        else if ((input & 0xf0) == 0xe0)
-        {
-            return 3;
-        }
-        else if ((input & 0xf8) == 0xf0)
+        if (m_inline)
         {
-            return 4;
-        }
-        else if ((input & 0xfc) == 0xf8)
-        {
-            return 5;
-        }
-        else if ((input & 0xfe) == 0xfc)
-        {
-            return 6;
+            CopyInline(that);
         } else {
-            return 0;
+            m_storage = that.m_storage;
         }
+        that.m_offset = that.m_length = that.m_hash_code = 0;
+        that.m_ascii = that.m_inline = true;
     }
 
     String::String(const char* input)
         : m_offset(0)
         , m_length(0)
-        , m_runes(nullptr)
-        , m_counter(nullptr)
         , m_hash_code(0)
+        , m_ascii(true)
+        , m_inline(true)
     {
-        const char* p = input;
+        Assign(input);
+    }
+
+    String::String(const rune* c, std::size_t n)
+        : m_offset(0)
+        , m_length(0)
+        , m_hash_code(0)
+        , m_ascii(true)
+        , m_inline(true)
+    {
+        bool ascii = true;
 
-        if (!p)
+        if (!n)
         {
             return;
         }
-        while (*p)
+        for (std::size_t i = 0; i < n; ++i)
         {
-            std::size_t n = utf8_size(*p);
-
-            if (n)
+            if (c[i] > 0x7f)
             {
-                ++m_length;
-                p += n;
-            } else {
+                ascii = false;
                 break;
             }
         }
-        if (m_length)
+        Allocate(n, ascii);
+        if (ascii)
         {
-            bool valid = true;
+            byte* bytes = GetByteData();
 
-            m_runes = Memory::Allocate<rune>(m_length);
-            m_counter = Memory::Allocate<unsigned int>(1);
-            m_counter[0] = 1;
-            for (std::size_t i = 0; i < m_length; ++i)
+            for (std::size_t i = 0; i < n; ++i)
             {
-                std::size_t n = utf8_size(input[0]);
-                rune result;
-
-                switch (n)
-                {
-                    case 1:
-                        result = static_cast<rune>(input[0]);
-                        break;
-
-                    case 2:
-                        result = static_cast<rune>(input[0] & 0x1f);
-                        break;
-
-                    case 3:
-                        result = static_cast<rune>(input[0] & 0x0f);
-                        break;
-
-                    case 4:
-                        result = static_cast<rune>(input[0] & 0x07);
-                        break;
-
-                    case 5:
-                        result = static_cast<rune>(input[0] & 0x03);
-                        break;
-
-                    case 6:
-                        result = static_cast<rune>(input[0] & 0x01);
-                        break;
-
-                    default:
-                        valid = false;
-                }
-                if (valid)
-                {
-                    for (std::size_t j = 1; j < n; ++j)
-                    {
-                        if ((input[j] & 0xc0) == 0x80)
-                        {
-                            result = (result << 6) | (input[j] & 0x3f);
-                        } else {
-                            valid = false;
-                            break;
-                        }
-                    }
-                    if (valid)
-                    {
-                        m_runes[i] = result;
-                        input += n;
-                    } else {
-                        break;
-                    }
-                } else {
-                    break;
-                }
+                bytes[i] = static_cast<byte>(c[i]);
             }
+        } else {
+            Memory::Copy<rune>(GetRuneData(), c, n);
         }
     }
 
-    String::String(const rune* c, std::size_t n)
+    String::String(rune c, std::size_t n)
         : m_offset(0)
-        , m_length(n)
-        , m_runes(Memory::Allocate<rune>(m_length))
-        , m_counter(m_length ? Memory::Allocate<unsigned int>(1) : nullptr)
+        , m_length(0)
         , m_hash_code(0)
+        , m_ascii(true)
+        , m_inline(true)
     {
-        if (m_counter)
+        if (!n)
         {
-            m_counter[0] = 1;
-            Memory::Copy<rune>(m_runes, c, n);
+            return;
         }
-    }
-
-    String::String(rune c, std::size_t n)
-        : m_offset(0)
-        , m_length(n)
-        , m_runes(Memory::Allocate<rune>(m_length))
-        , m_counter(m_length ? Memory::Allocate<unsigned int>(1) : nullptr)
-        , m_hash_code(0)
-    {
-        if (m_counter)
+        Allocate(n, c <= 0x7f);
+        if (m_ascii)
         {
-            m_counter[0] = 1;
-            for (std::size_t i = 0; i < m_length; ++i)
+            std::memset(GetByteData(), static_cast<int>(c), n);
+        } else {
+            rune* runes = GetRuneData();
+
+            for (std::size_t i = 0; i < n; ++i)
             {
-                m_runes[i] = c;
+                runes[i] = c;
             }
         }
     }
 
     String::~String()
     {
-        if (m_counter && --m_counter[0] == 0)
+        Release();
+    }
+
+    void String::Allocate(std::size_t length, bool ascii, std::size_t capacity)
+    {
+        const std::size_t size = ascii ? sizeof(byte) : sizeof(rune);
+        Counter* counter;
+
+        if (capacity < length)
         {
-            Memory::Unallocate<rune>(m_runes);
-            Memory::Unallocate<unsigned int>(m_counter);
+            capacity = length;
+        }
+        if (capacity * size <= sizeof(m_inline_bytes))
+        {
+            m_offset = 0;
+            m_length = length;
+            m_hash_code = 0;
+            m_ascii = ascii;
+            m_inline = true;
+
+            return;
         }
+        // Character data is placed right after the counter, so that both are
+        // allocated at once. Nothing is modified before the allocation has
+        // succeeded.
+        if (!(counter = reinterpret_cast<Counter*>(Memory::Allocate<byte>(sizeof(Counter) + capacity * size))))
+        {
+            throw std::bad_alloc();
+        }
+        m_offset = 0;
+        m_length = length;
+        m_hash_code = 0;
+        m_ascii = ascii;
+        counter->references = 1;
+        counter->capacity = capacity;
+        counter->size = length;
+        m_inline = false;
+        m_storage.counter = counter;
+        m_storage.bytes = reinterpret_cast<byte*>(counter + 1);
     }
 
     String String::DecodeAscii(const byte* input)
@@ -232,22 +202,57 @@ namespace tempearly
     String String::DecodeAscii(const byte* input, std::size_t length)
     {
         String result;
+        bool ascii;
 
-        if (length > 0)
+        if (!length)
         {
-            result.m_length = length;
-            result.m_runes = Memory::Allocate<rune>(length);
-            result.m_counter = Memory::Allocate<unsigned int>(1);
-            result.m_counter[0] = 1;
+            return result;
+        }
+        ascii = Utf8::CountAscii(input, length) == length;
+        result.Allocate(length, ascii);
+        if (ascii)
+        {
+            Memory::Copy<byte>(result.GetByteData(), input, length);
+        } else {
+            rune* runes = result.GetRuneData();
+
             for (std::size_t i = 0; i < length; ++i)
             {
-                result.m_runes[i] = static_cast<rune>(input[i]);
+                runes[i] = static_cast<rune>(input[i]);
             }
         }
 
         return result;
     }
 
+    String String::DecodeUtf8(const byte* input, std::size_t length)
+    {
+        const std::size_t ascii = Utf8::CountAscii(input, length);
+        String result;
+        std::size_t read;
+
+        if (ascii < length)
+        {
+            result.Allocate(Utf8::CountRunes(input, length), false);
+            // Truncate the string at the first malformed sequence.
+            result.m_length = Utf8::Decode(input, length, result.GetRuneData(), read);
+            if (read > ascii)
+            {
+                return result;
+            }
+            // Nothing beyond the US-ASCII prefix could be decoded, so the
+            // string is stored as bytes instead.
+            result = String();
+        }
+        if (ascii)
+        {
+            result.Allocate(ascii, true);
+            Memory::Copy<byte>(result.GetByteData(), input, ascii);
+        }
+
+        return result;
+    }
+
     String String::FromU64(u64 number, int radix)
     {
         if (radix < 2 || radix > 36)
@@ -322,179 +327,84 @@ namespace tempearly
 
     String& String::Assign(const String& that)
     {
-        if (m_runes != that.m_runes)
+        if (this == &that)
         {
-            if (m_counter && --m_counter[0] == 0)
-            {
-                Memory::Unallocate<rune>(m_runes);
-                Memory::Unallocate<unsigned int>(m_counter);
-            }
-            m_runes = that.m_runes;
-            if ((m_counter = that.m_counter))
-            {
-                ++m_counter[0];
-            }
+            return *this;
+        }
+        else if (that.m_inline)
+        {
+            Release();
+            CopyInline(that);
+        }
+        else if (m_inline || m_storage.counter != that.m_storage.counter)
+        {
+            Release();
+            m_storage = that.m_storage;
+            ++m_storage.counter->references;
         }
         m_offset = that.m_offset;
         m_length = that.m_length;
         m_hash_code = that.m_hash_code;
+        m_ascii = that.m_ascii;
+        m_inline = that.m_inline;
 
         return *this;
     }
 
     String& String::Assign(const char* input)
     {
-        const char* p = input;
-
-        if (m_counter && --m_counter[0] == 0)
-        {
-            Memory::Unallocate<rune>(m_runes);
-            Memory::Unallocate<unsigned int>(m_counter);
-        }
-        m_offset = m_length = m_hash_code = 0;
-        if (!p)
-        {
-            return *this;
-        }
-        while (*p)
+        if (input)
         {
-            std::size_t n = utf8_size(*p);
-
-            if (n)
-            {
-                ++m_length;
-                p += n;
-            } else {
-                break;
-            }
-        }
-        if (m_length)
-        {
-            bool valid = true;
-
-            m_runes = Memory::Allocate<rune>(m_length);
-            m_counter = Memory::Allocate<unsigned int>(1);
-            m_counter[0] = 1;
-            for (std::size_t i = 0; i < m_length; ++i)
-            {
-                std::size_t n = utf8_size(input[0]);
-                rune result;
-
-                switch (n)
-                {
-                    case 1:
-                        result = static_cast<rune>(input[0]);
-                        break;
-
-                    case 2:
-                        result = static_cast<rune>(input[0] & 0x1f);
-                        break;
-
-                    case 3:
-                        result = static_cast<rune>(input[0] & 0x0f);
-                        break;
-
-                    case 4:
-                        result = static_cast<rune>(input[0] & 0x07);
-                        break;
-
-                    case 5:
-                        result = static_cast<rune>(input[0] & 0x03);
-                        break;
-
-                    case 6:
-                        result = static_cast<rune>(input[0] & 0x01);
-                        break;
-
-                    default:
-                        valid = false;
-                }
-                if (valid)
-                {
-                    for (std::size_t j = 1; j < n; ++j)
-                    {
-                        if ((input[j] & 0xc0) == 0x80)
-                        {
-                            result = (result << 6) | (input[j] & 0x3f);
-                        } else {
-                            valid = false;
-                            break;
-                        }
-                    }
-                    if (valid)
-                    {
-                        m_runes[i] = result;
-                        input += n;
-                    } else {
-                        break;
-                    }
-                } else {
-                    break;
-                }
-            }
+            return *this = DecodeUtf8(reinterpret_cast<const byte*>(input), std::strlen(input));
         }
 
-        return *this;
+        return *this = String();
     }
 
     String& String::operator=(String&& that)
     {
-        if (m_counter && --m_counter[0] == 0)
+        if (this == &that)
+        {
+            return *this;
+        }
+        Release();
+        if ((m_inline = that.m_inline))
         {
-            Memory::Unallocate<rune>(m_runes);
-            Memory::Unallocate<unsigned int>(m_counter);
+            CopyInline(that);
+        } else {
+            m_storage = that.m_storage;
         }
         m_offset = that.m_offset;
         m_length = that.m_length;
-        m_runes = that.m_runes;
-        m_counter = that.m_counter;
         m_hash_code = that.m_hash_code;
+        m_ascii = that.m_ascii;
         that.m_offset = that.m_length = that.m_hash_code = 0;
-        that.m_runes = nullptr;
-        that.m_counter = nullptr;
+        that.m_ascii = that.m_inline = true;
 
         return *this;
     }
 
     ByteString String::Encode() const
     {
-        Vector<byte> bytes;
+        const rune* runes;
+        byte* bytes;
 
-        bytes.Reserve(m_length);
-        for (std::size_t i = 0; i < m_length; ++i)
+        if (!m_length)
         {
-            const rune r = m_runes[m_offset + i];
-
-            if (r > 0x10ffff
-                || (r & 0xfffe) == 0xfffe
-                || (r >= 0xd800 && r <= 0xdfff)
-                || (r >= 0xfdd0 && r <= 0xfdef))
-            {
-                continue;
-            }
-            else if (r <= 0x7f)
-            {
-                bytes.PushBack(static_cast<byte>(r));
-            }
-            else if (r <= 0x07ff)
-            {
-                bytes.PushBack(static_cast<byte>(0xc0 | ((r & 0x7c0) >> 6)));
-                bytes.PushBack(static_cast<byte>(0x80 | (r & 0x3f)));
-            }
-            else if (r <= 0xffff)
-            {
-                bytes.PushBack(static_cast<byte>(0xe0 | ((r & 0xf000)) >> 12));
-                bytes.PushBack(static_cast<byte>(0x80 | ((r & 0xfc0)) >> 6));
-                bytes.PushBack(static_cast<byte>(0x80 | (r & 0x3f)));
-            } else {
-                bytes.PushBack(static_cast<byte>(0xf0 | ((r & 0x1c0000) >> 18)));
-                bytes.PushBack(static_cast<byte>(0x80 | ((r & 0x3f000) >> 12)));
-                bytes.PushBack(static_cast<byte>(0x80 | ((r & 0xfc0) >> 6)));
-                bytes.PushBack(static_cast<byte>(0x80 | (r & 0x3f)));
-            }
+            return ByteString();
+        }
+        else if (m_ascii)
+        {
+            return ByteString(GetByteData(), m_length);
         }
+        runes = GetRuneData();
+        // Encoded size is exact, so the bytes can be encoded straight into
+        // the storage of the byte string.
+        ByteString result(Utf8::EncodedSize(runes, m_length), bytes);
 
-        return ByteString(bytes.GetData(), bytes.GetSize());
+        Utf8::Encode(runes, m_length, bytes);
+
+        return result;
     }
 
 #if defined(_WIN32)
@@ -505,7 +415,7 @@ namespace tempearly
         result.reserve(m_length);
         for (std::size_t i = 0; i < m_length; ++i)
         {
-            rune r = m_runes[m_offset + i];
+            rune r = At(i);
 
             if (r > 0xffff)
             {
@@ -540,19 +450,19 @@ namespace tempearly
         {
             std::size_t offset = 0;
 
-            result.m_length = length;
-            result.m_runes = Memory::Allocate<rune>(length);
-            result.m_counter = Memory::Allocate<unsigned int>(1);
-            result.m_counter[0] = 1;
+            rune* runes;
+
+            result.Allocate(length, false);
+            runes = result.GetRuneData();
             for (const wchar_t* p = input; *p; ++p)
             {
                 if (*p < 0xd800 || *p > 0xdfff)
                 {
-                    result.m_runes[offset++] = *p;
+                    runes[offset++] = *p;
                 }
                 else if (p[1] >= 0xdc00 || p[1] <= 0xdfff)
                 {
-                    result.m_runes[offset++] = ((p[0] - 0xd7c0) << 10) + (p[1] - 0xdc00);
+                    runes[offset++] = ((p[0] - 0xd7c0) << 10) + (p[1] - 0xdc00);
                     ++p;
                 }
             }
@@ -562,28 +472,320 @@ namespace tempearly
     }
 #endif
 
+    namespace
+    {
+        /**
+         * Key used for hashing strings.
+         */
+        struct HashKey
+        {
+            u64 k0;
+            u64 k1;
+        };
+
+        /**
+         * Incremental implementation of SipHash-1-3.
+         */
+        class SipHasher
+        {
+        public:
+            explicit SipHasher(const HashKey& key)
+                : m_v0(key.k0 ^ 0x736f6d6570736575)
+                , m_v1(key.k1 ^ 0x646f72616e646f6d)
+                , m_v2(key.k0 ^ 0x6c7967656e657261)
+                , m_v3(key.k1 ^ 0x7465646279746573)
+                , m_tail(0)
+                , m_length(0) {}
+
+            void Update(const byte* data, std::size_t size)
+            {
+                std::size_t i = 0;
+
+                // Complete the word left unfinished by previous update.
+                while (i < size && (m_length & 7))
+                {
+                    m_tail |= static_cast<u64>(data[i++]) << (8 * (m_length++ & 7));
+                    if (!(m_length & 7))
+                    {
+                        Compress(m_tail);
+                        m_tail = 0;
+                    }
+                }
+                for (; i + 8 <= size; i += 8)
+                {
+                    Compress(
+                        static_cast<u64>(data[i])
+                        | static_cast<u64>(data[i + 1]) << 8
+                        | static_cast<u64>(data[i + 2]) << 16
+                        | static_cast<u64>(data[i + 3]) << 24
+                        | static_cast<u64>(data[i + 4]) << 32
+                        | static_cast<u64>(data[i + 5]) << 40
+                        | static_cast<u64>(data[i + 6]) << 48
+                        | static_cast<u64>(data[i + 7]) << 56
+                    );
+                    m_length += 8;
+                }
+                for (; i < size; ++i)
+                {
+                    m_tail |= static_cast<u64>(data[i]) << (8 * (m_length++ & 7));
+                }
+            }
+
+            u64 Finish()
+            {
+                const u64 last = static_cast<u64>(m_length) << 56 | m_tail;
+
+                Compress(last);
+                m_v2 ^= 0xff;
+                Round();
+                Round();
+                Round();
+
+                return m_v0 ^ m_v1 ^ m_v2 ^ m_v3;
+            }
+
+        private:
+            static inline u64 Rotate(u64 x, int bits)
+            {
+                return (x << bits) | (x >> (64 - bits));
+            }
+
+            inline void Round()
+            {
+                m_v0 += m_v1;
+                m_v1 = Rotate(m_v1, 13);
+                m_v1 ^= m_v0;
+                m_v0 = Rotate(m_v0, 32);
+                m_v2 += m_v3;
+                m_v3 = Rotate(m_v3, 16);
+                m_v3 ^= m_v2;
+                m_v0 += m_v3;
+                m_v3 = Rotate(m_v3, 21);
+                m_v3 ^= m_v0;
+                m_v2 += m_v1;
+                m_v1 = Rotate(m_v1, 17);
+                m_v1 ^= m_v2;
+                m_v2 = Rotate(m_v2, 32);
+            }
+
+            inline void Compress(u64 word)
+            {
+                m_v3 ^= word;
+                Round();
+                m_v0 ^= word;
+            }
+
+            u64 m_v0;
+            u64 m_v1;
+            u64 m_v2;
+            u64 m_v3;
+            /** Bytes of the current unfinished word. */
+            u64 m_tail;
+            /** Total number of bytes hashed so far. */
+            std::size_t m_length;
+        };
+    }
+
+    /**
+     * Generates random key for string hashing. Operating system's random
+     * number generator is used when available, so that hash codes of strings
+     * cannot be predicted from outside of the process.
+     */
+    static HashKey hash_key_generate()
+    {
+        HashKey key = { 0, 0 };
+        std::FILE* urandom = std::fopen("/dev/urandom", "rb");
+        const HashKey* address = &key;
+
+        if (urandom)
+        {
+            if (std::fread(&key, sizeof(key), 1, urandom) != 1)
+            {
+                key.k0 = key.k1 = 0;
+            }
+            std::fclose(urandom);
+        }
+        if (!key.k0 && !key.k1)
+        {
+            key.k0 = static_cast<u64>(std::time(nullptr)) ^ static_cast<u64>(std::clock()) << 32;
+            key.k1 = static_cast<u64>(reinterpret_cast<std::size_t>(address)) ^ 0x9e3779b97f4a7c15;
+        }
+
+        return key;
+    }
+
+    /**
+     * Returns the string hashing key, which is shared by all threads of the
+     * process.
+     */
+    static inline const HashKey& hash_key()
+    {
+        static const HashKey key = hash_key_generate();
+
+        return key;
+    }
+
+    /**
+     * Encodes code point for hashing in an UTF-8 like encoding which is
+     * extended to cover every 32 bit value, including the ones which are not
+     * valid Unicode characters. Returns number of bytes used.
+     */
+    static inline std::size_t hash_encode_rune(byte* output, rune r)
+    {
+        std::size_t length;
+
+        if (r < 0x800)
+        {
+            output[0] = static_cast<byte>(0xc0 | (r >> 6));
+            length = 2;
+        }
+        else if (r < 0x10000)
+        {
+            output[0] = static_cast<byte>(0xe0 | (r >> 12));
+            length = 3;
+        }
+        else if (r < 0x200000)
+        {
+            output[0] = static_cast<byte>(0xf0 | (r >> 18));
+            length = 4;
+        }
+        else if (r < 0x4000000)
+        {
+            output[0] = static_cast<byte>(0xf8 | (r >> 24));
+            length = 5;
+        }
+        else if (r < 0x80000000)
+        {
+            output[0] = static_cast<byte>(0xfc | (r >> 30));
+            length = 6;
+        } else {
+            output[0] = 0xfe;
+            length = 7;
+        }
+        for (std::size_t i = length - 1; i > 0; --i)
+        {
+            output[i] = static_cast<byte>(0x80 | (r & 0x3f));
+            r >>= 6;
+        }
+
+        return length;
+    }
+
     std::size_t String::HashCode() const
     {
         std::size_t h = m_hash_code;
 
         if (h == 0)
         {
-            h = 5381;
-            for (std::size_t i = 0; i < m_length; ++i)
+            SipHasher hasher(hash_key());
+
+            if (m_ascii)
             {
-                h = ((h << 5) + h) + m_runes[m_offset + i];
+                hasher.Update(GetByteData(), m_length);
+            } else {
+                const rune* runes = GetRuneData();
+                byte buffer[256];
+
+                // Characters are hashed in an UTF-8 like encoding, so that
+                // strings stored as runes hash identically to equal strings
+                // stored as bytes. Each chunk of characters fits into the
+                // buffer even when all of them need the longest encoding.
+                for (std::size_t i = 0; i < m_length;)
+                {
+                    const std::size_t end = m_length - i < sizeof(buffer) / 7 ? m_length : i + sizeof(buffer) / 7;
+                    std::size_t size = 0;
+
+                    for (; i < end; ++i)
+                    {
+                        if (runes[i] < 0x80)
+                        {
+                            buffer[size++] = static_cast<byte>(runes[i]);
+                        } else {
+                            size += hash_encode_rune(buffer + size, runes[i]);
+                        }
+                    }
+                    hasher.Update(buffer, size);
+                }
             }
-            m_hash_code = h;
+            m_hash_code = h = static_cast<std::size_t>(hasher.Finish());
         }
 
         return h;
     }
 
+    /**
+     * Symbol table of the current thread. This is an open addressing hash
+     * table whose size is always a power of two, empty strings marking the
+     * unused slots.
+     */
+    static thread_local Vector<String> symbol_table;
+    /** Number of strings stored in the symbol table. */
+    static thread_local std::size_t symbol_count = 0;
+
+    /**
+     * Doubles the size of the symbol table and rehashes the strings stored
+     * in it.
+     */
+    static void symbol_table_grow()
+    {
+        const std::size_t size = symbol_table.IsEmpty() ? 256 : symbol_table.GetSize() * 2;
+        Vector<String> table(size, String());
+
+        for (std::size_t i = 0; i < symbol_table.GetSize(); ++i)
+        {
+            const String& symbol = symbol_table[i];
+            std::size_t index;
+
+            if (symbol.IsEmpty())
+            {
+                continue;
+            }
+            index = symbol.HashCode() & (size - 1);
+            while (!table[index].IsEmpty())
+            {
+                index = (index + 1) & (size - 1);
+            }
+            table[index] = symbol;
+        }
+        symbol_table.Assign(table);
+    }
+
+    String String::Intern() const
+    {
+        const std::size_t hash_code = HashCode();
+        std::size_t mask;
+        std::size_t index;
+
+        if (!m_length)
+        {
+            return *this;
+        }
+        if ((symbol_count + 1) * 2 > symbol_table.GetSize())
+        {
+            symbol_table_grow();
+        }
+        mask = symbol_table.GetSize() - 1;
+        for (index = hash_code & mask;
+             !symbol_table[index].IsEmpty();
+             index = (index + 1) & mask)
+        {
+            const String& symbol = symbol_table[index];
+
+            if (symbol.m_hash_code == hash_code && symbol.Equals(*this))
+            {
+                return symbol;
+            }
+        }
+        ++symbol_count;
+
+        return symbol_table[index] = *this;
+    }
+
     std::size_t String::IndexOf(rune r, std::size_t pos) const
     {
         for (std::size_t i = pos; i < m_length; ++i)
         {
-            if (m_runes[m_offset + i] == r)
+            if (At(i) == r)
             {
                 return i;
             }
@@ -600,7 +802,7 @@ namespace tempearly
         }
         for (std::size_t i = pos; i > 0; --i)
         {
-            if (m_runes[m_offset + i - 1] == r)
+            if (At(i - 1) == r)
             {
                 return i - 1;
             }
@@ -617,21 +819,14 @@ namespace tempearly
         {
             return result;
         }
-        else if (count == npos)
+        else if (count > m_length - pos)
         {
             count = m_length - pos;
         }
-        else if (count > m_length)
-        {
-            count = m_length;
-        }
-        result.m_offset = m_offset + pos;
+        result = *this;
+        result.m_offset += pos;
         result.m_length = count;
-        result.m_runes = m_runes;
-        if ((result.m_counter = m_counter))
-        {
-            ++m_counter[0];
-        }
+        result.m_hash_code = 0;
 
         return result;
     }
@@ -642,14 +837,14 @@ namespace tempearly
 
         for (i = 0; i < m_length; ++i)
         {
-            if (!std::isspace(m_runes[m_offset + i]))
+            if (!std::isspace(At(i)))
             {
                 break;
             }
         }
         for (j = m_length; j != 0; --j)
         {
-            if (!std::isspace(m_runes[m_offset + j - 1]))
+            if (!std::isspace(At(j - 1)))
             {
                 break;
             }
@@ -658,15 +853,11 @@ namespace tempearly
         {
             return *this;
         } else {
-            String result;
+            String result(*this);
 
-            result.m_offset = m_offset + i;
+            result.m_offset += i;
             result.m_length = j - i;
-            result.m_runes = m_runes;
-            if ((result.m_counter = m_counter))
-            {
-                ++m_counter[0];
-            }
+            result.m_hash_code = 0;
 
             return result;
         }
@@ -674,17 +865,21 @@ namespace tempearly
 
     bool String::Equals(const String& that) const
     {
-        if (m_runes == that.m_runes)
+        if (m_length != that.m_length)
         {
-            return m_offset == that.m_offset && m_length == that.m_length;
+            return false;
         }
-        else if (m_length != that.m_length)
+        else if (SharesData(that))
         {
-            return false;
+            return true;
+        }
+        else if (m_ascii && that.m_ascii)
+        {
+            return !std::memcmp(GetByteData(), that.GetByteData(), m_length);
         }
         for (std::size_t i = 0; i < m_length; ++i)
         {
-            if (m_runes[m_offset + i] != that.m_runes[that.m_offset + i])
+            if (At(i) != that.At(i))
             {
                 return false;
             }
@@ -695,18 +890,18 @@ namespace tempearly
 
     bool String::EqualsIgnoreCase(const String& that) const
     {
-        if (m_runes == that.m_runes)
+        if (m_length != that.m_length)
         {
-            return m_offset == that.m_offset && m_length == that.m_length;
+            return false;
         }
-        else if (m_length != that.m_length)
+        else if (SharesData(that))
         {
-            return false;
+            return true;
         }
         for (std::size_t i = 0; i < m_length; ++i)
         {
-            const rune a = ToLower(m_runes[m_offset + i]);
-            const rune b = ToLower(that.m_runes[that.m_offset + i]);
+            const rune a = ToLower(At(i));
+            const rune b = ToLower(that.At(i));
 
             if (a != b)
             {
@@ -719,7 +914,7 @@ namespace tempearly
 
     int String::Compare(const String& that) const
     {
-        if (m_runes != that.m_runes || m_offset != that.m_offset)
+        if (!SharesData(that))
         {
             std::size_t n = m_length;
 
@@ -729,8 +924,8 @@ namespace tempearly
             }
             for (std::size_t i = 0; i < n; ++i)
             {
-                const rune a = m_runes[m_offset + i];
-                const rune b = that.m_runes[that.m_offset + i];
+                const rune a = At(i);
+                const rune b = that.At(i);
 
                 if (a != b)
                 {
@@ -748,7 +943,7 @@ namespace tempearly
 
     int String::CompareIgnoreCase(const String& that) const
     {
-        if (m_runes != that.m_runes || m_offset != that.m_offset)
+        if (!SharesData(that))
         {
             std::size_t n = m_length;
 
@@ -758,8 +953,8 @@ namespace tempearly
             }
             for (std::size_t i = 0; i < n; ++i)
             {
-                const rune a = ToLower(m_runes[m_offset + i]);
-                const rune b = ToLower(that.m_runes[that.m_offset + i]);
+                const rune a = ToLower(At(i));
+                const rune b = ToLower(that.At(i));
 
                 if (a != b)
                 {
@@ -787,7 +982,7 @@ namespace tempearly
         }
         else if (that.m_length == 1)
         {
-            return m_runes[m_offset + m_length - 1] == that.m_runes[that.m_offset];
+            return At(m_length - 1) == that.At(0);
         }
         else if (that.m_length > m_length)
         {
@@ -799,7 +994,7 @@ namespace tempearly
         }
         for (std::size_t i = 0; i < that.m_length; ++i)
         {
-            if (m_runes[m_offset + i] != that.m_runes[that.m_offset + i])
+            if (At(i) != that.At(i))
             {
                 return false;
             }
@@ -810,18 +1005,16 @@ namespace tempearly
 
     void String::Clear()
     {
-        if (m_counter && --m_counter[0] == 0)
-        {
-            Memory::Unallocate<rune>(m_runes);
-            Memory::Unallocate<unsigned int>(m_counter);
-        }
+        Release();
         m_offset = m_length = m_hash_code = 0;
-        m_runes = nullptr;
-        m_counter = nullptr;
+        m_ascii = m_inline = true;
     }
 
     String String::Concat(const String& that) const
     {
+        const std::size_t length = m_length + that.m_length;
+        String result;
+
         if (!m_length)
         {
             return that;
@@ -829,18 +1022,61 @@ namespace tempearly
         else if (!that.m_length)
         {
             return *this;
-        } else {
-            String result;
-
-            result.m_length = m_length + that.m_length;
-            result.m_runes = Memory::Allocate<rune>(result.m_length);
-            result.m_counter = Memory::Allocate<unsigned int>(1);
-            result.m_counter[0] = 1;
-            Memory::Copy<rune>(result.m_runes, m_runes + m_offset, m_length);
-            Memory::Copy<rune>(result.m_runes + m_length, that.m_runes + that.m_offset, that.m_length);
+        }
+        // When this string ends where the characters written into it's data
+        // end, no other string can see the spare capacity after it, so the
+        // other string can be appended there without copying this one. This
+        // makes repeated appending into a string amortized constant time.
+        // Short strings stored inside the string object itself have no spare
+        // capacity which could be shared.
+        if (!m_inline
+            && m_storage.counter->size == m_offset + m_length
+            && m_storage.counter->capacity >= m_offset + length
+            && (!m_ascii || that.m_ascii))
+        {
+            result = *this;
+            if (m_ascii)
+            {
+                Memory::Copy<byte>(m_storage.bytes + m_offset + m_length, that.GetByteData(), that.m_length);
+            } else {
+                for (std::size_t i = 0; i < that.m_length; ++i)
+                {
+                    m_storage.runes[m_offset + m_length + i] = that.At(i);
+                }
+            }
+            m_storage.counter->size += that.m_length;
+            result.m_length = length;
+            result.m_hash_code = 0;
 
             return result;
         }
+        // Strings which are not tiny are given some spare capacity, in case
+        // more will be appended into them.
+        result.Allocate(
+            length,
+            m_ascii && that.m_ascii,
+            length < kConcatSpareLimit ? length : length + length / 2
+        );
+        if (result.m_ascii)
+        {
+            byte* bytes = result.GetByteData();
+
+            Memory::Copy<byte>(bytes, GetByteData(), m_length);
+            Memory::Copy<byte>(bytes + m_length, that.GetByteData(), that.m_length);
+        } else {
+            rune* runes = result.GetRuneData();
+
+            for (std::size_t i = 0; i < m_length; ++i)
+            {
+                runes[i] = At(i);
+            }
+            for (std::size_t i = 0; i < that.m_length; ++i)
+            {
+                runes[m_length + i] = that.At(i);
+            }
+        }
+
+        return result;
     }
 
     bool String::Matches(bool (*callback)(rune)) const
@@ -851,7 +1087,7 @@ namespace tempearly
         }
         for (std::size_t i = 0; i < m_length; ++i)
         {
-            if (!callback(m_runes[m_offset + i]))
+            if (!callback(At(i)))
             {
                 return false;
             }
@@ -862,32 +1098,25 @@ namespace tempearly
 
     String String::Map(rune (*callback)(rune)) const
     {
-        String result;
+        StringBuilder result(m_length);
 
-        if (m_length)
+        for (std::size_t i = 0; i < m_length; ++i)
         {
-            result.m_length = m_length;
-            result.m_runes = Memory::Allocate<rune>(m_length);
-            result.m_counter = Memory::Allocate<unsigned int>(1);
-            result.m_counter[0] = 1;
-            for (std::size_t i = 0; i < m_length; ++i)
-            {
-                result.m_runes[i] = callback(m_runes[m_offset + i]);
-            }
+            result << callback(At(i));
         }
 
-        return result;
+        return result.ToString();
     }
 
     bool String::IsIdentifier() const
     {
-        if (!m_length || (m_runes[m_offset] != '_' && !std::isalpha(m_runes[m_offset])))
+        if (!m_length || (At(0) != '_' && !std::isalpha(At(0))))
         {
             return false;
         }
         for (std::size_t i = 1; i < m_length; ++i)
         {
-            if (m_runes[m_offset + i] != '_' && !std::isalnum(m_runes[m_offset + i]))
+            if (At(i) != '_' && !std::isalnum(At(i)))
             {
                 return false;
             }
@@ -1262,6 +1491,10 @@ namespace tempearly
             { 0x100000, 0x10fffd }
         };
 
+        if (c < 0x80)
+        {
+            return c < 0x20 || c == 0x7f;
+        }
         for (int i = 0; i < 19; ++i)
         {
             if (c >= cntrl_table[i][0] && c <= cntrl_table[i][1])
@@ -1459,21 +1692,109 @@ namespace tempearly
         }
     }
 
+    /**
+     * Returns index of the first byte in given US-ASCII data which is either
+     * a control character or one of the given special characters, or length
+     * of the data if there is no such byte. When SSE2 is available, the data
+     * is scanned 16 bytes at a time.
+     */
+    static inline std::size_t ascii_find_special(const byte* data,
+                                                 std::size_t length,
+                                                 const char* specials,
+                                                 std::size_t special_count)
+    {
+        std::size_t i = 0;
+
+#if defined(TEMPEARLY_STRING_SSE2)
+        const __m128i space = _mm_set1_epi8(0x20);
+        const __m128i del = _mm_set1_epi8(0x7f);
+
+        for (; i + 16 <= length; i += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            // US-ASCII bytes are never negative, so signed comparison can be
+            // used for detecting control characters.
+            __m128i found = _mm_or_si128(
+                _mm_cmplt_epi8(chunk, space),
+                _mm_cmpeq_epi8(chunk, del)
+            );
+
+            for (std::size_t j = 0; j < special_count; ++j)
+            {
+                found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(specials[j])));
+            }
+            if (_mm_movemask_epi8(found))
+            {
+                // Exact position is resolved by the scalar loop below.
+                break;
+            }
+        }
+#endif
+        for (; i < length; ++i)
+        {
+            const byte b = data[i];
+
+            if (b < 0x20 || b == 0x7f)
+            {
+                return i;
+            }
+            for (std::size_t j = 0; j < special_count; ++j)
+            {
+                if (b == static_cast<byte>(specials[j]))
+                {
+                    return i;
+                }
+            }
+        }
+
+        return length;
+    }
+
     String String::EscapeXml() const
     {
+        static const char specials[] = "&<>\"'";
+        const std::size_t special_count = sizeof(specials) - 1;
+
+        if (m_ascii)
+        {
+            const byte* data = GetByteData();
+            std::size_t i = ascii_find_special(data, m_length, specials, special_count);
+            StringBuilder result;
+
+            if (i == m_length)
+            {
+                return *this;
+            }
+            result.Reserve(m_length + 16);
+            for (std::size_t start = 0;;)
+            {
+                result.Append(SubString(start, i - start));
+                if (i == m_length)
+                {
+                    break;
+                }
+                escape_xml_char(result, data[i]);
+                start = ++i;
+                i += ascii_find_special(data + i, m_length - i, specials, special_count);
+            }
+
+            return result.ToString();
+        }
+        const rune* runes = GetRuneData();
+
         for (std::size_t i = 0; i < m_length; ++i)
         {
-            const rune r = m_runes[m_offset + i];
+            const rune r = runes[i];
 
             if (r == '&' || r == '<' || r == '>' || r == '"' || r == '\'' || String::IsControl(r))
             {
                 StringBuilder result(m_length + 16);
 
-                result.Append(m_runes + m_offset, i);
+                result.Append(SubString(0, i));
                 escape_xml_char(result, r);
                 for (std::size_t j = i + 1; j < m_length; ++j)
                 {
-                    escape_xml_char(result, m_runes[m_offset + j]);
+                    escape_xml_char(result, runes[j]);
                 }
 
                 return result.ToString();
@@ -1527,19 +1848,49 @@ namespace tempearly
 
     String String::EscapeJavaScript() const
     {
+        static const char specials[] = "\"\\";
+        const std::size_t special_count = sizeof(specials) - 1;
+
+        if (m_ascii)
+        {
+            const byte* data = GetByteData();
+            std::size_t i = ascii_find_special(data, m_length, specials, special_count);
+            StringBuilder result;
+
+            if (i == m_length)
+            {
+                return *this;
+            }
+            result.Reserve(m_length + 16);
+            for (std::size_t start = 0;;)
+            {
+                result.Append(SubString(start, i - start));
+                if (i == m_length)
+                {
+                    break;
+                }
+                escape_js_char(result, data[i]);
+                start = ++i;
+                i += ascii_find_special(data + i, m_length - i, specials, special_count);
+            }
+
+            return result.ToString();
+        }
+        const rune* runes = GetRuneData();
+
         for (std::size_t i = 0; i < m_length; ++i)
         {
-            const rune r = m_runes[m_offset + i];
+            const rune r = runes[i];
 
             if (r == '"' || r == '\\' || IsControl(r))
             {
                 StringBuilder result(m_length + 16);
 
-                result.Append(m_runes + m_offset, i);
+                result.Append(SubString(0, i));
                 escape_js_char(result, r);
                 for (std::size_t j = i + 1; j < m_length; ++j)
                 {
-                    escape_js_char(result, m_runes[m_offset + j]);
+                    escape_js_char(result, runes[j]);
                 }
 
                 return result.ToString();
@@ -1553,51 +1904,51 @@ namespace tempearly
     {
         const String trimmed = Trim();
         std::size_t remaining = trimmed.GetLength();
-        const rune* ptr = trimmed.GetRunes();
+        std::size_t pos = 0;
         u64 number = 0;
         bool sign = true;
         
         // Get the sign.
         if (remaining)
         {
-            if (*ptr == '-')
+            if (trimmed[pos] == '-')
             {
                 sign = false;
-                ++ptr; --remaining;
+                ++pos; --remaining;
             }
-            else if (*ptr == '+')
+            else if (trimmed[pos] == '+')
             {
-                ++ptr; --remaining;
+                ++pos; --remaining;
             }
         }
 
         // Try to decipher the prefix.
-        if (radix <= 0 && remaining > 1 && *ptr == '0')
+        if (radix <= 0 && remaining > 1 && trimmed[pos] == '0')
         {
-            ++ptr; --remaining;
-            switch (*ptr)
+            ++pos; --remaining;
+            switch (trimmed[pos])
             {
                 // Hexadecimal
                 case 'x': case 'X':
                     radix = 16;
-                    ++ptr; --remaining;
+                    ++pos; --remaining;
                     break;
 
                 // Binary
                 case 'b': case 'B':
                     radix = 2;
-                    ++ptr; --remaining;
+                    ++pos; --remaining;
                     break;
 
                 // Decimal
                 case 'd': case 'D':
                     radix = 10;
-                    ++ptr; --remaining;
+                    ++pos; --remaining;
                     break;
 
                 // Octal
                 case 'o': case 'O':
-                    ++ptr; --remaining;
+                    ++pos; --remaining;
 
                 // Default to octal
                 default:
@@ -1616,7 +1967,7 @@ namespace tempearly
         while (remaining)
         {
             unsigned int digit;
-            char c = *ptr++;
+            char c = trimmed[pos++];
 
             --remaining;
             if (c >= '0' && c < static_cast<char>('0' + radix))
@@ -1668,7 +2019,7 @@ namespace tempearly
             slot = -INFINITY;
         } else {
             std::size_t remaining = trimmed.GetLength();
-            const rune* ptr = trimmed.GetRunes();
+            std::size_t pos = 0;
             double number = 0.0;
             bool sign;
             i64 exponent = 0;
@@ -1676,29 +2027,29 @@ namespace tempearly
             bool has_dot = false;
 
             // Get the sign.
-            sign = !(remaining && *ptr == '-');
-            if (!sign || (remaining && *ptr == '+'))
+            sign = !(remaining && trimmed[pos] == '-');
+            if (!sign || (remaining && trimmed[pos] == '+'))
             {
-                ++ptr; --remaining;
+                ++pos; --remaining;
             }
 
-            for (; remaining; ++ptr, --remaining)
+            for (; remaining; ++pos, --remaining)
             {
-                if (std::isdigit(*ptr))
+                if (std::isdigit(trimmed[pos]))
                 {
                     has_digits = true;
                     if (number > DBL_MAX * 0.1)
                     {
                         ++exponent;
                     } else {
-                        number = (number * 10.0) + (*ptr - '0');
+                        number = (number * 10.0) + (trimmed[pos] - '0');
                     }
                     if (has_dot)
                     {
                         --exponent;
                     }
                 }
-                else if (!has_dot && *ptr == '.')
+                else if (!has_dot && trimmed[pos] == '.')
                 {
                     has_dot = true;
                 } else {
@@ -1714,9 +2065,9 @@ namespace tempearly
             }
 
             // Parse exponent (this is kinda shitty way to it though)
-            if (remaining && (*ptr == 'e' || *ptr == 'E'))
+            if (remaining && (trimmed[pos] == 'e' || trimmed[pos] == 'E'))
             {
-                if (!String(++ptr, --remaining).ParseInt(exponent, 10))
+                if (!trimmed.SubString(++pos, --remaining).ParseInt(exponent, 10))
                 {
                     return false;
                 }
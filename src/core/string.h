@@ -10,9 +10,15 @@
 namespace tempearly
 {
     /**
-     * Implementation of (mostly) immutable Unicode string. Character data is
-     * stored internally as Unicode code points and encoded into UTF-8 when
-     * required.
+     * Implementation of (mostly) immutable Unicode string. Strings which
+     * consist only of US-ASCII characters are stored internally as single
+     * bytes, which are also valid UTF-8, so that they take a quarter of the
+     * memory and can be encoded into UTF-8 by simply copying them. Other
+     * strings are stored as Unicode code points and encoded into UTF-8 when
+     * required. In both cases characters can be accessed by their index in
+     * constant time. Short strings are stored inside of the string object
+     * itself, while character data of longer ones is allocated together
+     * with it's reference counter.
      */
     class String
     {
@@ -76,6 +82,16 @@ namespace tempearly
          */
         static String DecodeAscii(const byte* input, std::size_t length);
 
+        /**
+         * Constructs string from bytes which are expected to be in UTF-8
+         * character encoding. The string is truncated at the first malformed
+         * sequence.
+         *
+         * \param input  The bytes to decode
+         * \param length Number of bytes contained in the array
+         */
+        static String DecodeUtf8(const byte* input, std::size_t length);
+
         /**
          * Digitizes given unsigned 64 bit integer into string.
          *
@@ -148,12 +164,12 @@ namespace tempearly
         }
 
         /**
-         * Returns pointer to the character data. If the string is empty, this
-         * could be NULL.
+         * Returns true if the character data of the string is stored as
+         * US-ASCII bytes.
          */
-        inline const rune* GetRunes() const
+        inline bool IsAscii() const
         {
-            return m_runes ? m_runes + m_offset : nullptr;
+            return m_ascii;
         }
 
         /**
@@ -162,7 +178,7 @@ namespace tempearly
          */
         inline rune GetFront() const
         {
-            return m_runes[m_offset];
+            return At(0);
         }
 
         /**
@@ -171,7 +187,7 @@ namespace tempearly
          */
         inline rune GetBack() const
         {
-            return m_runes[m_offset + m_length - 1];
+            return At(m_length - 1);
         }
 
         /**
@@ -180,7 +196,12 @@ namespace tempearly
          */
         inline rune At(std::size_t i) const
         {
-            return m_runes[m_offset + i];
+            if (m_ascii)
+            {
+                return static_cast<rune>(GetByteData()[i]);
+            }
+
+            return GetRuneData()[i];
         }
 
         /**
@@ -189,7 +210,7 @@ namespace tempearly
          */
         inline rune operator[](std::size_t i) const
         {
-            return m_runes[m_offset + i];
+            return At(i);
         }
 
         /**
@@ -213,9 +234,21 @@ namespace tempearly
         /**
          * Calculates hash code for the string. This is usually done only once,
          * since the resulting hash code is cached for performance reasons.
+         * Strings are hashed with SipHash-1-3 using a key which is randomly
+         * generated for each process, so hash codes are not stable between
+         * processes.
          */
         std::size_t HashCode() const;
 
+        /**
+         * Returns copy of the string from the symbol table of the current
+         * thread, inserting the string into the table if it isn't there yet.
+         * Interned copies of equal strings share their characters and hash
+         * code, so comparing them does not need to look at the characters
+         * and using them as dictionary keys does not need to hash them again.
+         */
+        String Intern() const;
+
         /**
          * Searches for index of the given rune in the string and returns it if
          * found. Otherwise, npos is returned.
@@ -417,16 +450,139 @@ namespace tempearly
         bool ParseDouble(double& slot) const;
 
     private:
+        /**
+         * Header of the character data, shared by all strings which use the
+         * same data. The characters follow the header in the same allocation.
+         */
+        struct Counter
+        {
+            /** Number of strings using the data. */
+            unsigned int references;
+            /** Number of characters which fit into the data. */
+            std::size_t capacity;
+            /** Number of characters written into the data. */
+            std::size_t size;
+        };
+
+        /**
+         * Location of character data which is stored outside of the string
+         * object.
+         */
+        struct Storage
+        {
+            /** Pointer to the character data. */
+            union
+            {
+                byte* bytes;
+                rune* runes;
+            };
+            /** Counter used for tracking usage of the data. */
+            Counter* counter;
+        };
+
+        /**
+         * Returns pointer to the first character of a string which is stored
+         * as bytes.
+         */
+        inline const byte* GetByteData() const
+        {
+            return (m_inline ? m_inline_bytes : m_storage.bytes) + m_offset;
+        }
+
+        /**
+         * Returns pointer to the first character of a string which is stored
+         * as runes.
+         */
+        inline const rune* GetRuneData() const
+        {
+            return (m_inline ? m_inline_runes : m_storage.runes) + m_offset;
+        }
+
+        /**
+         * Returns pointer to the first character of a string which is stored
+         * as bytes.
+         */
+        inline byte* GetByteData()
+        {
+            return (m_inline ? m_inline_bytes : m_storage.bytes) + m_offset;
+        }
+
+        /**
+         * Returns pointer to the first character of a string which is stored
+         * as runes.
+         */
+        inline rune* GetRuneData()
+        {
+            return (m_inline ? m_inline_runes : m_storage.runes) + m_offset;
+        }
+
+        /**
+         * Returns true if both strings begin from the same character data.
+         */
+        inline bool SharesData(const String& that) const
+        {
+            return !m_inline
+                && !that.m_inline
+                && m_storage.counter == that.m_storage.counter
+                && m_offset == that.m_offset;
+        }
+
+        /**
+         * Copies the characters of given string, which must be stored inside
+         * of the string object, into the inline buffer of this string. Unused
+         * portion of the buffer is left as it is.
+         */
+        inline void CopyInline(const String& that)
+        {
+            const std::size_t end = that.m_offset + that.m_length;
+
+            if (that.m_ascii)
+            {
+                Memory::Copy<byte>(m_inline_bytes, that.m_inline_bytes, end);
+            } else {
+                Memory::Copy<rune>(m_inline_runes, that.m_inline_runes, end);
+            }
+        }
+
+        /**
+         * Allocates storage for given number of characters, either as bytes
+         * or as runes, with room for at least <i>capacity</i> characters.
+         * Short strings are stored inside of the string object. Previous
+         * contents of the string are not released.
+         */
+        void Allocate(std::size_t length, bool ascii, std::size_t capacity = 0);
+
+        /**
+         * Releases the character data of the string, if it's no longer used
+         * by any other string.
+         */
+        inline void Release()
+        {
+            if (!m_inline && --m_storage.counter->references == 0)
+            {
+                Memory::Unallocate<Counter>(m_storage.counter);
+            }
+        }
+
         /** Offset where the string contents begin. */
         std::size_t m_offset;
         /** Length of the string. */
         std::size_t m_length;
-        /** Pointer to the character data. */
-        rune* m_runes;
-        /** Counter used for tracking usage of the data. */
-        unsigned int* m_counter;
+        union
+        {
+            /** Character data stored outside of the string object. */
+            Storage m_storage;
+            /** Characters of short strings stored as bytes. */
+            byte m_inline_bytes[sizeof(Storage)];
+            /** Characters of short strings stored as runes. */
+            rune m_inline_runes[sizeof(Storage) / sizeof(rune)];
+        };
         /** Cached hash code of the string. */
         mutable std::size_t m_hash_code;
+        /** Whether the character data is stored as US-ASCII bytes. */
+        bool m_ascii;
+        /** Whether the character data is stored inside of the object. */
+        bool m_inline;
     };
 
     String operator+(const char* a, const String& b);
@@ -4,6 +4,31 @@
 
 namespace tempearly
 {
+    /**
+     * Returns new capacity for a string builder which needs room for given
+     * number of characters. The capacity grows geometrically, so that
+     * appending content piece by piece takes amortized constant time.
+     */
+    static inline std::size_t grow_capacity(std::size_t capacity, std::size_t needed)
+    {
+        capacity += capacity / 2 + 16;
+
+        return capacity < needed ? needed : capacity;
+    }
+
+    /**
+     * Copies characters of given string into an array of runes.
+     */
+    static inline void copy_string(rune* runes, const String& string)
+    {
+        const std::size_t length = string.GetLength();
+
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            runes[i] = string[i];
+        }
+    }
+
     StringBuilder::StringBuilder(std::size_t capacity)
         : m_capacity(capacity)
         , m_length(0)
@@ -22,7 +47,7 @@ namespace tempearly
         , m_length(m_capacity)
         , m_runes(Memory::Allocate<rune>(m_capacity))
     {
-        Memory::Copy<rune>(m_runes, string.GetRunes(), m_length);
+        copy_string(m_runes, string);
     }
 
     StringBuilder::~StringBuilder()
@@ -53,7 +78,8 @@ namespace tempearly
             Memory::Unallocate<rune>(m_runes);
             m_runes = Memory::Allocate<rune>(m_capacity = s.GetLength());
         }
-        Memory::Copy<rune>(m_runes, s.GetRunes(), m_length = s.GetLength());
+        copy_string(m_runes, s);
+        m_length = s.GetLength();
 
         return *this;
     }
@@ -110,7 +136,7 @@ namespace tempearly
     {
         if (m_capacity < m_length + 1)
         {
-            rune* runes = Memory::Allocate<rune>(m_capacity += 16);
+            rune* runes = Memory::Allocate<rune>(m_capacity = grow_capacity(m_capacity, m_length + 1));
 
             Memory::Copy<rune>(runes, m_runes, m_length);
             Memory::Unallocate<rune>(m_runes);
@@ -125,14 +151,26 @@ namespace tempearly
         {
             return;
         }
-        Reserve(m_length + n);
+        if (m_capacity < m_length + n)
+        {
+            Reserve(grow_capacity(m_capacity, m_length + n));
+        }
         Memory::Copy<rune>(m_runes + m_length, c, n);
         m_length += n;
     }
 
     void StringBuilder::Append(const String& s)
     {
-        Append(s.GetRunes(), s.GetLength());
+        if (s.IsEmpty())
+        {
+            return;
+        }
+        if (m_capacity < m_length + s.GetLength())
+        {
+            Reserve(grow_capacity(m_capacity, m_length + s.GetLength()));
+        }
+        copy_string(m_runes + m_length, s);
+        m_length += s.GetLength();
     }
 
     void StringBuilder::Prepend(rune c)
@@ -141,7 +179,7 @@ namespace tempearly
         {
             Memory::Move<rune>(m_runes + 1, m_runes, m_length);
         } else {
-            rune* runes = Memory::Allocate<rune>(m_capacity += 16);
+            rune* runes = Memory::Allocate<rune>(m_capacity = grow_capacity(m_capacity, m_length + 1));
 
             Memory::Copy<rune>(runes + 1, m_runes, m_length);
             Memory::Unallocate<rune>(m_runes);
@@ -161,7 +199,7 @@ namespace tempearly
         {
             Memory::Move<rune>(m_runes + n, m_runes, m_length);
         } else {
-            rune* runes = Memory::Allocate<rune>(m_capacity += n);
+            rune* runes = Memory::Allocate<rune>(m_capacity = grow_capacity(m_capacity, m_length + n));
 
             Memory::Copy<rune>(runes + n, m_runes, m_length);
             Memory::Unallocate<rune>(m_runes);
@@ -173,7 +211,24 @@ namespace tempearly
 
     void StringBuilder::Prepend(const String& string)
     {
-        Prepend(string.GetRunes(), string.GetLength());
+        const std::size_t n = string.GetLength();
+
+        if (!n)
+        {
+            return;
+        }
+        if (m_capacity >= m_length + n)
+        {
+            Memory::Move<rune>(m_runes + n, m_runes, m_length);
+        } else {
+            rune* runes = Memory::Allocate<rune>(m_capacity = grow_capacity(m_capacity, m_length + n));
+
+            Memory::Copy<rune>(runes + n, m_runes, m_length);
+            Memory::Unallocate<rune>(m_runes);
+            m_runes = runes;
+        }
+        copy_string(m_runes, string);
+        m_length += n;
     }
 
     rune StringBuilder::PopFront()
@@ -0,0 +1,262 @@
+#include "core/utf8.h"
+
+#if defined(TEMPEARLY_HAVE_EMMINTRIN_H) && (defined(__SSE2__) || defined(_M_X64))
+# include <emmintrin.h>
+# define TEMPEARLY_UTF8_SSE2 1
+#endif
+
+namespace tempearly
+{
+    /**
+     * Decodes single multi-byte sequence of given length into a code point.
+     * Returns false if one of the continuation bytes is malformed.
+     */
+    static inline bool decode_sequence(const byte* data, std::size_t length, rune& slot)
+    {
+        rune result = static_cast<rune>(data[0] & (0x7f >> length));
+
+        for (std::size_t i = 1; i < length; ++i)
+        {
+            if ((data[i] & 0xc0) != 0x80)
+            {
+                return false;
+            }
+            result = (result << 6) | (data[i] & 0x3f);
+        }
+        slot = result;
+
+        return true;
+    }
+
+    /**
+     * Returns true if given code point can be encoded into UTF-8.
+     */
+    static inline bool is_encodable(rune r)
+    {
+        return r <= 0x10ffff
+            && (r & 0xfffe) != 0xfffe
+            && (r < 0xd800 || r > 0xdfff)
+            && (r < 0xfdd0 || r > 0xfdef);
+    }
+
+    std::size_t Utf8::CountAscii(const byte* data, std::size_t size)
+    {
+        std::size_t i = 0;
+
+#if defined(TEMPEARLY_UTF8_SSE2)
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+            if (_mm_movemask_epi8(chunk))
+            {
+                break;
+            }
+        }
+#endif
+        while (i < size && data[i] < 0x80)
+        {
+            ++i;
+        }
+
+        return i;
+    }
+
+    std::size_t Utf8::CountRunes(const byte* data, std::size_t size)
+    {
+        std::size_t count = 0;
+        std::size_t i = 0;
+
+#if defined(TEMPEARLY_UTF8_SSE2)
+        // Continuation bytes are the only ones which are less than 0xc0 when
+        // compared as signed integers.
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(0xc0));
+
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            int mask = _mm_movemask_epi8(_mm_cmplt_epi8(chunk, limit));
+
+            count += 16;
+            for (; mask; mask &= mask - 1)
+            {
+                --count;
+            }
+        }
+#endif
+        for (; i < size; ++i)
+        {
+            if ((data[i] & 0xc0) != 0x80)
+            {
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    std::size_t Utf8::Decode(const byte* data,
+                             std::size_t size,
+                             rune* output,
+                             std::size_t& read)
+    {
+        std::size_t length = 0;
+        std::size_t i = 0;
+
+        while (i < size)
+        {
+            std::size_t n;
+
+#if defined(TEMPEARLY_UTF8_SSE2)
+            // Runs of US-ASCII bytes are widened into code points 16 bytes at
+            // a time.
+            while (i + 16 <= size)
+            {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                const __m128i zero = _mm_setzero_si128();
+                __m128i* out = reinterpret_cast<__m128i*>(output + length);
+                __m128i half;
+
+                if (_mm_movemask_epi8(chunk))
+                {
+                    break;
+                }
+                half = _mm_unpacklo_epi8(chunk, zero);
+                _mm_storeu_si128(out, _mm_unpacklo_epi16(half, zero));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(half, zero));
+                half = _mm_unpackhi_epi8(chunk, zero);
+                _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(half, zero));
+                _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(half, zero));
+                i += 16;
+                length += 16;
+            }
+            if (i >= size)
+            {
+                break;
+            }
+#endif
+            if (data[i] < 0x80)
+            {
+                output[length++] = static_cast<rune>(data[i++]);
+                continue;
+            }
+            n = SequenceLength(data[i]);
+            if (!n || i + n > size || !decode_sequence(data + i, n, output[length]))
+            {
+                break;
+            }
+            ++length;
+            i += n;
+        }
+        read = i;
+
+        return length;
+    }
+
+    std::size_t Utf8::EncodedSize(const rune* runes, std::size_t length)
+    {
+        std::size_t size = 0;
+        std::size_t i = 0;
+
+#if defined(TEMPEARLY_UTF8_SSE2)
+        const __m128i high = _mm_set1_epi32(~0x7f);
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; i + 4 <= length; i += 4)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(runes + i));
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(chunk, high), zero)) != 0xffff)
+            {
+                break;
+            }
+            size += 4;
+        }
+#endif
+        for (; i < length; ++i)
+        {
+            const rune r = runes[i];
+
+            if (r <= 0x7f)
+            {
+                ++size;
+            }
+            else if (is_encodable(r))
+            {
+                size += r <= 0x07ff ? 2 : r <= 0xffff ? 3 : 4;
+            }
+        }
+
+        return size;
+    }
+
+    std::size_t Utf8::Encode(const rune* runes, std::size_t length, byte* output)
+    {
+        std::size_t size = 0;
+        std::size_t i = 0;
+
+        while (i < length)
+        {
+            rune r;
+
+#if defined(TEMPEARLY_UTF8_SSE2)
+            // Runs of US-ASCII code points are narrowed into bytes 16 code
+            // points at a time.
+            while (i + 16 <= length)
+            {
+                const __m128i* in = reinterpret_cast<const __m128i*>(runes + i);
+                const __m128i a = _mm_loadu_si128(in);
+                const __m128i b = _mm_loadu_si128(in + 1);
+                const __m128i c = _mm_loadu_si128(in + 2);
+                const __m128i d = _mm_loadu_si128(in + 3);
+                const __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(
+                    _mm_and_si128(all, _mm_set1_epi32(~0x7f)),
+                    _mm_setzero_si128()
+                )) != 0xffff)
+                {
+                    break;
+                }
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(output + size),
+                    _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d))
+                );
+                i += 16;
+                size += 16;
+            }
+            if (i >= length)
+            {
+                break;
+            }
+#endif
+            r = runes[i++];
+            if (r <= 0x7f)
+            {
+                output[size++] = static_cast<byte>(r);
+            }
+            else if (!is_encodable(r))
+            {
+                continue;
+            }
+            else if (r <= 0x07ff)
+            {
+                output[size++] = static_cast<byte>(0xc0 | ((r & 0x7c0) >> 6));
+                output[size++] = static_cast<byte>(0x80 | (r & 0x3f));
+            }
+            else if (r <= 0xffff)
+            {
+                output[size++] = static_cast<byte>(0xe0 | ((r & 0xf000) >> 12));
+                output[size++] = static_cast<byte>(0x80 | ((r & 0xfc0) >> 6));
+                output[size++] = static_cast<byte>(0x80 | (r & 0x3f));
+            } else {
+                output[size++] = static_cast<byte>(0xf0 | ((r & 0x1c0000) >> 18));
+                output[size++] = static_cast<byte>(0x80 | ((r & 0x3f000) >> 12));
+                output[size++] = static_cast<byte>(0x80 | ((r & 0xfc0) >> 6));
+                output[size++] = static_cast<byte>(0x80 | (r & 0x3f));
+            }
+        }
+
+        return size;
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef TEMPEARLY_CORE_UTF8_H_GUARD
+#define TEMPEARLY_CORE_UTF8_H_GUARD
+
+#include "memory.h"
+
+namespace tempearly
+{
+    /**
+     * Bulk routines for validating and transcoding UTF-8 encoded data. Runs
+     * of US-ASCII characters are processed 16 bytes at a time when SSE2 is
+     * available.
+     */
+    class Utf8
+    {
+    public:
+        /**
+         * Returns length of the UTF-8 sequence which begins with given byte,
+         * or 0 if the byte cannot begin a sequence.
+         */
+        static inline std::size_t SequenceLength(byte lead)
+        {
+            if ((lead & 0x80) == 0x00)
+            {
+                return 1;
+            }
+            else if ((lead & 0xe0) == 0xc0)
+            {
+                return 2;
+            }
+            else if ((lead & 0xf0) == 0xe0)
+            {
+                return 3;
+            }
+            else if ((lead & 0xf8) == 0xf0)
+            {
+                return 4;
+            }
+            else if ((lead & 0xfc) == 0xf8)
+            {
+                return 5;
+            }
+            else if ((lead & 0xfe) == 0xfc)
+            {
+                return 6;
+            }
+
+            return 0;
+        }
+
+        /**
+         * Returns number of US-ASCII bytes at the beginning of given data.
+         */
+        static std::size_t CountAscii(const byte* data, std::size_t size);
+
+        /**
+         * Returns number of bytes in given data which begin an UTF-8
+         * sequence, which is an upper bound for number of code points the
+         * data decodes into.
+         */
+        static std::size_t CountRunes(const byte* data, std::size_t size);
+
+        /**
+         * Decodes UTF-8 encoded data into Unicode code points. Decoding stops
+         * at the first malformed sequence, or at a sequence which is cut
+         * short by the end of the data.
+         *
+         * \param data   Data to decode
+         * \param size   Number of bytes in the data
+         * \param output Array where the code points are stored into. Must have
+         *               room for as many code points as returned by
+         *               <code>CountRunes</code>.
+         * \param read   This is where the number of bytes successfully
+         *               decoded will be stored into
+         * \return       Number of code points stored into the output array
+         */
+        static std::size_t Decode(const byte* data,
+                                  std::size_t size,
+                                  rune* output,
+                                  std::size_t& read);
+
+        /**
+         * Returns number of bytes required for encoding given code points
+         * into UTF-8. Code points which cannot be encoded are not counted.
+         */
+        static std::size_t EncodedSize(const rune* runes, std::size_t length);
+
+        /**
+         * Encodes Unicode code points into UTF-8, skipping code points which
+         * are not valid Unicode characters.
+         *
+         * \param runes  Code points to encode
+         * \param length Number of code points
+         * \param output Array where the bytes are stored into. Must have room
+         *               for at least as many bytes as returned by
+         *               <code>EncodedSize</code>.
+         * \return       Number of bytes stored into the output array
+         */
+        static std::size_t Encode(const rune* runes, std::size_t length, byte* output);
+
+    private:
+        TEMPEARLY_DISALLOW_IMPLICIT_CONSTRUCTORS(Utf8);
+    };
+}
+
+#endif /* !TEMPEARLY_CORE_UTF8_H_GUARD */
@@ -46,6 +46,7 @@ namespace tempearly
     typedef u8 byte;
     typedef u32 rune;
 
+    class AttributeCache;
     class ByteString;
     class Class;
     class CountedObject;
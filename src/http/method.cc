@@ -5,7 +5,8 @@ namespace tempearly
 {
     typedef Dictionary<HttpMethod::Kind> HttpMethodMap;
 
-    static HttpMethodMap method_map;
+    // Filled lazily and separately for each thread.
+    static thread_local HttpMethodMap method_map;
 
     static void fill_method_map()
     {
@@ -5,7 +5,8 @@ namespace tempearly
 {
     typedef Dictionary<HttpVersion::Kind> HttpVersionMap;
 
-    static HttpVersionMap version_map;
+    // Filled lazily and separately for each thread.
+    static thread_local HttpVersionMap version_map;
 
     static void fill_version_map()
     {
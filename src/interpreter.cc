@@ -17,6 +17,7 @@ namespace tempearly
     void init_file(Interpreter*);
     void init_filters(Interpreter*);
     void init_function(Interpreter*);
+    void init_gc(Interpreter*);
     void init_iterable(Interpreter*);
     void init_iterator(Interpreter*);
     void init_list(Interpreter*);
@@ -84,6 +85,7 @@ namespace tempearly
 
         init_request(this);
         init_response(this);
+        init_gc(this);
     }
 
     bool Interpreter::Include(const Filename& filename)
@@ -252,7 +254,12 @@ namespace tempearly
                                          const Handle<FunctionObject>& function,
                                          const Vector<Handle<Object>>& arguments)
     {
-        Handle<Frame> frame = new Frame(m_frame, enclosing, function, arguments);
+        Handle<Frame> frame;
+
+        // Function calls are safepoints of the garbage collector, as well as
+        // iterations of loops.
+        Heap::Safepoint();
+        frame = new Frame(m_frame, enclosing, function, arguments);
 
         m_frame = frame.Get();
 
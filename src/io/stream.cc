@@ -1,7 +1,9 @@
 #include <cstdarg>
+#include <cstring>
 
 #include "core/bytestring.h"
 #include "core/string.h"
+#include "core/utf8.h"
 #include "io/stream.h"
 
 #if !defined(BUFSIZ)
@@ -12,6 +14,33 @@ namespace tempearly
 {
     const std::size_t Stream::kBufferSize = BUFSIZ;
 
+    /**
+     * Returns number of line breaks in given data.
+     */
+    static inline int count_lines(const byte* data, std::size_t size)
+    {
+        int count = 0;
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if (data[i] > '\r')
+            {
+                continue;
+            }
+            else if (i + 1 < size && data[i] == '\r' && data[i + 1] == '\n')
+            {
+                ++count;
+                ++i;
+            }
+            else if (data[i] == '\n' || data[i] == '\r')
+            {
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
     Stream::Stream(std::size_t buffer_size)
         : m_buffer_size(buffer_size)
         , m_buffer(Memory::Allocate<byte>(m_buffer_size))
@@ -65,116 +94,171 @@ namespace tempearly
         {
             return false;
         }
-        for (std::size_t i = 0; i < read; ++i)
-        {
-            if (i + 1 < read && buffer[i] == '\r' && buffer[i + 1] == '\n')
-            {
-                ++m_line;
-                ++i;
-            }
-            else if (buffer[i] == '\n' || buffer[i] == '\r')
-            {
-                ++m_line;
-            }
-        }
+        m_line += count_lines(buffer, read);
 
         return true;
     }
 
-    static inline std::size_t utf8_size(unsigned char input)
+    /**
+     * Reads a single UTF-8 encoded character from a stream which has no
+     * buffer, one byte at a time.
+     */
+    static Stream::ReadResult read_rune_unbuffered(Stream* stream, rune& slot)
     {
-        if ((input & 0x80) == 0x00)
-        {
-            return 1;
-        }
-        else if ((input & 0xc0) == 0x80)
-        {
-            return 0;
-        }
-        else if ((input & 0xe0) == 0xc0)
+        byte buffer[6];
+        std::size_t size;
+        std::size_t read;
+
+        if (!stream->Read(buffer, 1, read))
         {
-            return 2;
+            return Stream::ERROR;
         }
-        else if ((input & 0xf0) == 0xe0)
+        else if (read < 1)
         {
-            return 3;
+            return Stream::END_OF_INPUT;
         }
-        else if ((input & 0xf8) == 0xf0)
+        slot = 0xfffd; // Invalid code point
+        if (!(size = Utf8::SequenceLength(buffer[0])))
         {
-            return 4;
+            return Stream::DECODING_ERROR;
         }
-        else if ((input & 0xfc) == 0xf8)
+        if (size > 1 && (!stream->Read(buffer + 1, size - 1, read) || read < size - 1))
         {
-            return 5;
+            return Stream::DECODING_ERROR;
         }
-        else if ((input & 0xfe) == 0xfc)
+        if (Utf8::Decode(buffer, size, &slot, read) != 1)
         {
-            return 6;
-        } else {
-            return 0;
+            slot = 0xfffd;
+
+            return Stream::DECODING_ERROR;
         }
+
+        return Stream::SUCCESS;
     }
 
     Stream::ReadResult Stream::ReadRune(rune& slot)
     {
-        byte buffer[6];
         std::size_t read;
-        std::size_t size;
-        
-        if (!Read(buffer, 1, read))
+
+        // US-ASCII characters are taken directly from the buffer.
+        if (m_remain > 0 && m_buffer[m_offset] < 0x80)
         {
-            return ERROR;
+            slot = static_cast<rune>(m_buffer[m_offset++]);
+            --m_remain;
+            if (slot == '\n' || slot == '\r')
+            {
+                ++m_line;
+            }
+
+            return SUCCESS;
         }
-        else if (read < 1)
+
+        return ReadRunes(&slot, 1, read);
+    }
+
+    Stream::ReadResult Stream::ReadRunes(rune* buffer, std::size_t size, std::size_t& read)
+    {
+        read = 0;
+        if (!size)
         {
-            return END_OF_INPUT;
+            return SUCCESS;
         }
-        switch (size = utf8_size(buffer[0]))
+        else if (!m_buffer)
         {
-            case 1:
-                slot = static_cast<rune>(buffer[0]);
-                break;
+            ReadResult result = read_rune_unbuffered(this, buffer[0]);
 
-            case 2:
-                slot = static_cast<rune>(buffer[0] & 0x1f);
-                break;
-
-            case 3:
-                slot = static_cast<rune>(buffer[0] & 0x0f);
-                break;
-
-            case 4:
-                slot = static_cast<rune>(buffer[0] & 0x07);
-                break;
-
-            case 5:
-                slot = static_cast<rune>(buffer[0] & 0x03);
-                break;
-
-            case 6:
-                slot = static_cast<rune>(buffer[0] & 0x01);
-                break;
+            if (result == SUCCESS || result == DECODING_ERROR)
+            {
+                read = 1;
+            }
 
-            default:
-                slot = 0xfffd; // Invalid code point
-                return DECODING_ERROR;
+            return result;
         }
-        if (size > 1 && (!Read(buffer + 1, size - 1, read) || read < size - 1))
+        while (read < size)
         {
-            slot = 0xfffd;
+            const byte* data;
+            std::size_t limit;
+            std::size_t count;
+            std::size_t consumed;
+            std::size_t length;
 
-            return DECODING_ERROR;
-        }
-        for (std::size_t i = 1; i < size; ++i)
-        {
-            if ((buffer[i] & 0xc0) == 0x80)
+            if (!m_remain)
             {
-                slot = (slot << 6) | (buffer[i] & 0x3f);
-            } else {
-                slot = 0xfffd;
+                // Do not wait for more input if something has already been
+                // decoded.
+                if (read > 0)
+                {
+                    break;
+                }
+                m_offset = 0;
+                if (!DirectRead(m_buffer, m_buffer_size, m_remain))
+                {
+                    return ERROR;
+                }
+                else if (!m_remain)
+                {
+                    return END_OF_INPUT;
+                }
+            }
+            data = m_buffer + m_offset;
+            limit = size - read < m_remain ? size - read : m_remain;
+            if ((count = Utf8::Decode(data, limit, buffer + read, consumed)) > 0)
+            {
+                m_line += count_lines(data, consumed);
+                m_offset += consumed;
+                m_remain -= consumed;
+                read += count;
+                continue;
+            }
+            // Next sequence is either malformed, longer than the limit, or
+            // cut short by the end of the buffer.
+            length = Utf8::SequenceLength(data[0]);
+            if (length > m_remain && length <= m_buffer_size)
+            {
+                std::size_t more;
 
-                return DECODING_ERROR;
+                if (read > 0)
+                {
+                    break;
+                }
+                // Move the partial sequence to the beginning of the buffer
+                // and fill the rest of the buffer after it.
+                std::memmove(m_buffer, data, m_remain);
+                m_offset = 0;
+                if (!DirectRead(m_buffer + m_remain, m_buffer_size - m_remain, more))
+                {
+                    return ERROR;
+                }
+                else if (more > 0)
+                {
+                    m_remain += more;
+                    continue;
+                }
+            }
+            else if (length > 0 && Utf8::Decode(data, length, buffer + read, consumed) == 1)
+            {
+                m_offset += length;
+                m_remain -= length;
+                ++read;
+                continue;
             }
+            if (read > 0)
+            {
+                break;
+            }
+            // Skip the malformed sequence, up to the first byte which is not
+            // a continuation byte.
+            consumed = 1;
+            while (consumed < length && consumed < m_remain && (data[consumed] & 0xc0) == 0x80)
+            {
+                ++consumed;
+            }
+            m_offset += consumed;
+            m_remain -= consumed;
+            buffer[0] = 0xfffd; // Invalid code point
+            read = 1;
+
+            return DECODING_ERROR;
         }
 
         return SUCCESS;
@@ -186,18 +270,7 @@ namespace tempearly
         {
             return false;
         }
-        for (std::size_t i = 0; i < size; ++i)
-        {
-            if (i + 1 < size && data[i] == '\r' && data[i + 1] == '\n')
-            {
-                ++m_line;
-                ++i;
-            }
-            else if (data[i] == '\n' || data[i] == '\r')
-            {
-                ++m_line;
-            }
-        }
+        m_line += count_lines(data, size);
 
         return true;
     }
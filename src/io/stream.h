@@ -137,6 +137,22 @@ namespace tempearly
          */
         ReadResult ReadRune(rune& slot);
 
+        /**
+         * Reads and decodes multiple UTF-8 encoded characters from the stream
+         * at once. Decoding stops before a malformed sequence, so that it is
+         * reported by the next call, which skips the sequence and stores
+         * U+FFFD into the array instead.
+         *
+         * \param buffer Array where the resulting Unicode code points will be
+         *               stored into
+         * \param size   Maximum number of code points to read
+         * \param read   This is where the number of code points read will be
+         *               stored into
+         * \return       An enum which indicates whether the operation was
+         *               successfull or not
+         */
+        ReadResult ReadRunes(rune* buffer, std::size_t size, std::size_t& read);
+
         /**
          * Writes bytes directly to the stream, bypassing the stream buffer.
          *
@@ -198,11 +198,11 @@ namespace tempearly
                 return false;
             }
             parser->SkipWhitespace();
-            if (!parse_value(parser, interpreter, value))
+            if (!parse_value(parser, interpreter, value)
+                || !map->Insert(interpreter, hash, key, value))
             {
                 return false;
             }
-            map->Insert(hash, key, value);
             parser->SkipWhitespace();
             if (parser->ReadRune(','))
             {
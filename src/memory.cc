@@ -1,4 +1,33 @@
+#include <chrono>
+#include <climits>
+#include <cstddef>
+
+#include <typeinfo>
+
 #include "memory.h"
+#include "core/bytestring.h"
+#include "core/dictionary.h"
+#include "core/stringbuilder.h"
+#include "core/vector.h"
+
+#if defined(__GNUC__)
+# include <cxxabi.h>
+#endif
+
+#if defined(TEMPEARLY_GC_HUGE_PAGES) && !defined(TEMPEARLY_GC_MMAP)
+# define TEMPEARLY_GC_MMAP 1
+#endif
+#if defined(TEMPEARLY_GC_MMAP) && !defined(TEMPEARLY_HAVE_SYS_MMAN_H)
+# undef TEMPEARLY_GC_MMAP
+# undef TEMPEARLY_GC_HUGE_PAGES
+#endif
+#if defined(TEMPEARLY_GC_MMAP)
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+#if defined(__GLIBC__) || defined(_WIN32)
+# include <malloc.h>
+#endif
 
 #if !defined(TEMPEARLY_GC_THRESHOLD0)
 # define TEMPEARLY_GC_THRESHOLD0 1024
@@ -9,48 +38,62 @@
 #if !defined(TEMPEARLY_GC_THRESHOLD2)
 # define TEMPEARLY_GC_THRESHOLD2 16
 #endif
+#if !defined(TEMPEARLY_GC_ADAPTIVE)
+# define TEMPEARLY_GC_ADAPTIVE 0
+#endif
+#if !defined(TEMPEARLY_GC_PROFILE)
+# define TEMPEARLY_GC_PROFILE 0
+#endif
+#if !defined(TEMPEARLY_GC_ADAPTIVE_LIMIT)
+# define TEMPEARLY_GC_ADAPTIVE_LIMIT 16
+#endif
+#if !defined(TEMPEARLY_GC_ARENA_LIMIT)
+# define TEMPEARLY_GC_ARENA_LIMIT 256
+#endif
+#if !defined(TEMPEARLY_GC_SWEEP_BUDGET)
+# define TEMPEARLY_GC_SWEEP_BUDGET 256
+#endif
+#if !defined(TEMPEARLY_GC_RETAIN_BLOCKS)
+# define TEMPEARLY_GC_RETAIN_BLOCKS 32
+#endif
 
 namespace tempearly
 {
     namespace
     {
-        class Block;
-
-        struct Record
-        {
-            /** Size of the record. */
-            std::size_t size;
-            /** Pointer to the object. */
-            CountedObject* pointer;
-            /** Block where the record belongs to. */
-            Block* block;
-            /** Pointer to next record in the list. */
-            Record* next;
-            /** Pointer to previous record in the list. */
-            Record* prev;
-            /** Pointer to next record in generation. */
-            Record* next_in_generation;
-        };
-
         struct Generation
         {
-            /** Examination threshold of this generation. */
-            const int threshold;
+            /**
+             * Examination threshold of this generation, or zero if the heap
+             * has not been configured yet.
+             */
+            int threshold;
             /** Number of examinations performed in this generation. */
             int counter;
-            /** Pointer to the first slot in the generation. */
-            Record* head;
         };
 
-        class Block
+        /**
+         * Slot of an object which is not in use. Free slots of each size class
+         * are linked together through their own memory.
+         */
+        struct FreeSlot
         {
-        public:
-            /** Size of single memory block. */
-            static const std::size_t kBlockSize = 4096 * 32;
+            /** Pointer to next free slot of the size class. */
+            FreeSlot* next;
+        };
 
-            explicit Block(Block* next);
+        class Block : public BlockHeader
+        {
+        public:
+            explicit Block(std::size_t memory_size);
 
-            ~Block();
+            /**
+             * Returns the block which contains given object.
+             */
+            static inline Block* Of(const void* pointer)
+            {
+                return static_cast<Block*>(BlockHeader::Of(pointer));
+            }
 
             /**
              * Returns pointer to next block in the sequence.
@@ -61,293 +104,1743 @@ namespace tempearly
             }
 
             /**
-             * Attempts to allocate <i>size</i> amount of bytes memory from
-             * this block. Returns null if this block does not have enough
-             * free space available.
+             * Sets pointer to next block in the sequence.
+             */
+            inline void SetNext(Block* next)
+            {
+                m_next = next;
+            }
+
+            /**
+             * Returns pointer to next block in the list of blocks which
+             * contain objects waiting for finalization.
+             */
+            inline Block* GetPendingNext()
+            {
+                return m_pending_next;
+            }
+
+            /**
+             * Sets pointer to next block in the list of blocks which contain
+             * objects waiting for finalization.
+             */
+            inline void SetPendingNext(Block* next)
+            {
+                m_pending_next = next;
+            }
+
+            /**
+             * Returns true if the block is in the list of blocks which contain
+             * objects waiting for finalization.
+             */
+            inline bool IsPending() const
+            {
+                return m_pending;
+            }
+
+            /**
+             * Sets whether the block is in the list of blocks which contain
+             * objects waiting for finalization.
+             */
+            inline void SetPending(bool pending)
+            {
+                m_pending = pending;
+            }
+
+            /**
+             * Returns index of the size class which this block serves.
+             */
+            inline std::size_t GetSizeClass() const
+            {
+                return m_size_class;
+            }
+
+            /**
+             * Returns size of the memory occupied by the block, including the
+             * header.
+             */
+            inline std::size_t GetMemorySize() const
+            {
+                return m_memory_size;
+            }
+
+            /**
+             * Returns size of single object in this block.
+             */
+            inline std::size_t GetObjectSize() const
+            {
+                return m_object_size;
+            }
+
+            /**
+             * Returns number of objects from this block which are currently
+             * allocated, including unreachable objects which have not been
+             * released yet.
+             */
+            inline std::size_t GetUsedCount() const
+            {
+                return m_used_count;
+            }
+
+            /**
+             * Returns number of bitmap words which cover the portion of the
+             * block taken into use so far.
+             */
+            inline std::size_t GetWordCount() const
+            {
+                return (m_cursor + 63) / 64;
+            }
+
+            /**
+             * Returns state of 64 objects starting from given word.
+             */
+            inline Bits& GetBits(std::size_t word)
+            {
+                return m_bits[word];
+            }
+
+            /**
+             * Returns object in given index.
+             */
+            inline CountedObject* GetObject(std::size_t index)
+            {
+                return reinterpret_cast<CountedObject*>(m_objects + index * m_object_size);
+            }
+
+            /**
+             * Flags slot of given object as occupied. Objects allocated
+             * outside arenas begin their life in the youngest generation.
+             */
+            inline void Occupy(const void* pointer, bool young)
+            {
+                const std::size_t index = IndexOf(pointer);
+                const u64 bit = static_cast<u64>(1) << (index % 64);
+                Bits& bits = m_bits[index / 64];
+
+                bits.allocated |= bit;
+                if (young)
+                {
+                    bits.young |= bit;
+                }
+                ++m_used_count;
+            }
+
+            /**
+             * Bumps a new slot from the unused portion of the block. Returns
+             * null if the block has been exhausted.
+             */
+            inline void* Allocate()
+            {
+                if (m_cursor >= m_object_count)
+                {
+                    return nullptr;
+                }
+
+                return static_cast<void*>(m_objects + m_cursor++ * m_object_size);
+            }
+
+            /**
+             * Destroys next object waiting for finalization in this block.
+             * Returns false if there are no such objects left.
+             */
+            bool FinalizeNext();
+
+            /**
+             * Releases slots of finalized objects into given free list.
+             */
+            void Release(FreeSlot*& free_head);
+
+            /**
+             * Inserts every slot which is not occupied into given free list,
+             * including the unused portion of the block.
              */
-            Record* Allocate(std::size_t size);
+            void Drain(FreeSlot*& free_head);
 
             /**
-             * Used by the sweep operation to indicate that the given record
-             * has been sweeped and needs to be inserted into the linked list
-             * of free records.
+             * Clears the mark bits of every object in the block.
              */
-            void MarkAsFree(Record* record);
+            void Unmark();
+
+            /**
+             * Discards all objects of the block and prepares it to serve
+             * another size class. Objects contained by the block must have
+             * been destroyed already.
+             */
+            void Reset(std::size_t size_class, std::size_t object_size);
 
         private:
             /** Pointer to next memory block in sequence. */
             Block* m_next;
-            /** Pointer to the memory contained by the block. */
-            byte* m_data;
-            /** Amount of memory still available in this block. */
-            std::size_t m_remaining;
-            /** Pointer to first used record. */
-            Record* m_used_head;
-            /** Pointer to last used record. */
-            Record* m_used_tail;
-            /** Pointer to first free record. */
-            Record* m_free_head;
-            /** Pointer to last free record. */
-            Record* m_free_tail;
+            /**
+             * Pointer to next block which contains objects waiting for
+             * finalization.
+             */
+            Block* m_pending_next;
+            /** Size of the memory occupied by the block. */
+            std::size_t m_memory_size;
+            /** Index of the size class served by this block. */
+            std::size_t m_size_class;
+            /** Size of single object. */
+            std::size_t m_object_size;
+            /** Number of objects which fit in the block. */
+            std::size_t m_object_count;
+            /** Number of slots taken into use so far. */
+            std::size_t m_cursor;
+            /** Number of slots occupied by objects. */
+            std::size_t m_used_count;
+            /** Index from which finalization of the block continues. */
+            std::size_t m_finalize_cursor;
+            /** Whether the block contains objects waiting for finalization. */
+            bool m_pending;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Block);
         };
 
-        Block::Block(Block* next)
-            : m_next(next)
-            , m_data(static_cast<byte*>(std::malloc(kBlockSize)))
-            , m_remaining(kBlockSize)
-            , m_used_head(nullptr)
-            , m_used_tail(nullptr)
-            , m_free_head(nullptr)
-            , m_free_tail(nullptr)
+        struct ProfileCounter
+        {
+            /** Number of allocated objects. */
+            u64 objects;
+            /** Number of allocated bytes. */
+            u64 bytes;
+        };
+
+        struct SizeClass
         {
-            if (!m_data)
+            /** Block from which new objects are bumped from. */
+            Block* block;
+            /** Pointer to first free slot of this size class. */
+            FreeSlot* free_head;
+        };
+
+        /** Granularity of small size classes. */
+        static const std::size_t kSizeClassGranularity = 8;
+        /** Largest object size served by the linear size classes. */
+        static const std::size_t kSmallSizeLimit = 256;
+        /** Total number of size classes. */
+        static const std::size_t kSizeClassCount = kSmallSizeLimit / kSizeClassGranularity + 5;
+        /**
+         * Objects larger than this are not allocated from blocks, but from the
+         * large object space instead.
+         */
+        static const std::size_t kLargeSizeLimit = 8192;
+        /**
+         * Size of the block header, rounded up so that the objects following
+         * it stay properly aligned.
+         */
+        static const std::size_t kHeaderSize = (sizeof(Block) + 15) & ~static_cast<std::size_t>(15);
+
+        /**
+         * Returns number of bits set in given word.
+         */
+        static inline std::size_t bit_count(u64 word)
+        {
+#if defined(__GNUC__)
+            return static_cast<std::size_t>(__builtin_popcountll(word));
+#else
+            std::size_t count = 0;
+
+            for (; word; word &= word - 1)
             {
-                throw std::bad_alloc();
+                ++count;
             }
+
+            return count;
+#endif
         }
 
-        Block::~Block()
+        /**
+         * Returns index of the lowest bit set in given non-zero word.
+         */
+        static inline std::size_t bit_scan(u64 word)
         {
-            for (Record* record = m_used_head; record; record = record->next)
+#if defined(__GNUC__)
+            return static_cast<std::size_t>(__builtin_ctzll(word));
+#else
+            std::size_t index = 0;
+
+            while (!(word & 1))
             {
-                delete record->pointer;
+                word >>= 1;
+                ++index;
             }
-            if (m_data)
+
+            return index;
+#endif
+        }
+
+        /**
+         * Returns size of objects which are allocated from the given size
+         * class.
+         */
+        static inline std::size_t size_class_object_size(std::size_t index)
+        {
+            const std::size_t small_count = kSmallSizeLimit / kSizeClassGranularity;
+
+            if (index < small_count)
             {
-                std::free(static_cast<void*>(m_data));
+                return (index + 1) * kSizeClassGranularity;
             }
+
+            return kSmallSizeLimit << (index - small_count + 1);
         }
 
-        Record* Block::Allocate(std::size_t size)
+        /**
+         * Maps requested allocation size into index of a size class. Sizes up
+         * to 256 bytes are served with 8 byte granularity and larger sizes are
+         * rounded up to the next power of two.
+         */
+        static inline std::size_t size_class_index(std::size_t size)
         {
-            Record* record;
+            std::size_t index;
 
-            for (record = m_free_head; record; record = record->next)
+            if (size <= kSmallSizeLimit)
             {
-                if (record->size < size)
-                {
-                    continue;
-                }
-                else if (record->next && record->prev)
-                {
-                    record->next->prev = record->prev;
-                    record->prev->next = record->next;
-                }
-                else if (record->next)
-                {
-                    record->next->prev = nullptr;
-                    m_free_head = record->next;
-                }
-                else if (record->prev)
+                if (size < BlockHeader::kMinObjectSize)
                 {
-                    record->prev->next = nullptr;
-                    m_free_tail = record->prev;
-                } else {
-                    m_free_head = m_free_tail = nullptr;
-                }
-                record->prev = nullptr;
-                if ((record->next = m_used_head))
-                {
-                    record->next->prev = record;
-                } else {
-                    m_used_tail = record;
+                    size = BlockHeader::kMinObjectSize;
                 }
-                m_used_head = record;
 
-                return record;
+                return (size - 1) / kSizeClassGranularity;
             }
-            if (m_remaining < sizeof(Record) + size)
+            index = kSmallSizeLimit / kSizeClassGranularity;
+            while (size_class_object_size(index) < size)
             {
-                return nullptr;
-            }
-            record = reinterpret_cast<Record*>(m_data);
-            record->size = size;
-            record->pointer = reinterpret_cast<CountedObject*>(m_data + sizeof(Record));
-            m_data += sizeof(Record) + size;
-            m_remaining -= sizeof(Record) + size;
-            record->block = this;
-            record->prev = nullptr;
-            if ((record->next = m_used_head))
-            {
-                record->next->prev = record;
-            } else {
-                m_used_tail = record;
+                if (++index >= kSizeClassCount)
+                {
+                    throw std::bad_alloc();
+                }
             }
-            m_used_head = record;
 
-            return record;
+            return index;
         }
 
-        void Block::MarkAsFree(Record* record)
+        /**
+         * Allocates memory for a block of given size, aligned to the block
+         * size so that blocks can be found from addresses of their objects.
+         * With huge pages, this also lets the kernel back each block with a
+         * single huge page.
+         */
+        static byte* block_memory_allocate(std::size_t size)
         {
-            if (record->next && record->prev)
+#if defined(TEMPEARLY_GC_MMAP)
+            void* pointer = ::mmap(
+                nullptr,
+                size + BlockHeader::kBlockSize,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS,
+                -1,
+                0
+            );
+            byte* data;
+            std::size_t offset;
+            std::size_t head;
+
+            if (pointer == MAP_FAILED)
             {
-                record->next->prev = record->prev;
-                record->prev->next = record->next;
+                return nullptr;
             }
-            else if (record->next)
+            data = static_cast<byte*>(pointer);
+            offset = reinterpret_cast<std::size_t>(data) % BlockHeader::kBlockSize;
+            head = offset ? BlockHeader::kBlockSize - offset : 0;
+            if (head > 0)
             {
-                m_used_head = record->next;
-                record->next->prev = nullptr;
+                ::munmap(static_cast<void*>(data), head);
             }
-            else if (record->prev)
+            ::munmap(static_cast<void*>(data + head + size), BlockHeader::kBlockSize - head);
+            data += head;
+# if defined(TEMPEARLY_GC_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+            if (size == BlockHeader::kBlockSize)
             {
-                m_used_tail = record->prev;
-                record->prev->next = nullptr;
-                record->prev = nullptr;
-            } else {
-                m_used_head = m_used_tail = nullptr;
+                ::madvise(static_cast<void*>(data), size, MADV_HUGEPAGE);
             }
-            if ((record->next = m_free_head))
+# endif
+
+            return data;
+#elif defined(_WIN32)
+            return static_cast<byte*>(::_aligned_malloc(size, BlockHeader::kBlockSize));
+#else
+            void* pointer;
+
+            if (::posix_memalign(&pointer, BlockHeader::kBlockSize, size))
             {
-                record->next->prev = record;
-            } else {
-                m_free_tail = record;
+                return nullptr;
             }
-            m_free_head = record;
-            record->next_in_generation = nullptr;
-        }
-    }
 
-    /** Pointer to latest allocated block of memory. */
-    static Block* gc_block_head = nullptr;
+            return static_cast<byte*>(pointer);
+#endif
+        }
 
-    static Generation gc_generation[3] =
-    {
-        { TEMPEARLY_GC_THRESHOLD0, 0, nullptr },
-        { TEMPEARLY_GC_THRESHOLD0, 0, nullptr },
-        { TEMPEARLY_GC_THRESHOLD0, 0, nullptr }
-    };
+        /**
+         * Returns memory of a block back to the operating system.
+         */
+        static void block_memory_release(byte* data, std::size_t size)
+        {
+#if defined(TEMPEARLY_GC_MMAP)
+            ::munmap(static_cast<void*>(data), size);
+#elif defined(_WIN32)
+            static_cast<void>(size);
+            ::_aligned_free(static_cast<void*>(data));
+#else
+            static_cast<void>(size);
+            std::free(static_cast<void*>(data));
+#endif
+        }
 
-    static void gc_mark(Generation& generation)
-    {
-        for (Record* record = generation.head;
-             record;
-             record = record->next_in_generation)
+        /**
+         * Rounds size of a block in the large object space up to whole pages,
+         * so that the memory can be mapped and unmapped exactly.
+         */
+        static std::size_t block_memory_round(std::size_t size)
         {
-            CountedObject* object = record->pointer;
+#if defined(TEMPEARLY_GC_MMAP)
+            const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
 
-            if (!object->IsMarked() && object->GetReferenceCount())
-            {
-                object->Mark();
-            }
+            return (size + page_size - 1) / page_size * page_size;
+#else
+            return size;
+#endif
         }
-    }
 
-    static void gc_sweep(Generation& young, Generation& old)
-    {
-#if defined(TEMPEARLY_GC_DEBUG)
-        int saved_count = 0;
-        int destroyed_count = 0;
-#endif
-        Record* current = young.head;
-        Record* next;
-        Record* saved_head = nullptr;
-        Record* saved_tail = nullptr;
+        Block::Block(std::size_t memory_size)
+            : m_next(nullptr)
+            , m_pending_next(nullptr)
+            , m_memory_size(memory_size)
+            , m_size_class(0)
+            , m_object_size(0)
+            , m_object_count(0)
+            , m_cursor(0)
+            , m_used_count(0)
+            , m_finalize_cursor(0)
+            , m_pending(false) {}
 
-        young.head = nullptr;
-        for (; current; current = next)
+        bool Block::FinalizeNext()
         {
-            CountedObject* object = current->pointer;
+            const std::size_t word_count = GetWordCount();
 
-            next = current->next_in_generation;
-            if (object->IsMarked())
+            for (std::size_t i = m_finalize_cursor / 64; i < word_count; ++i)
             {
-#if defined(TEMPEARLY_GC_DEBUG)
-                ++saved_count;
-#endif
-                object->UnsetFlag(CountedObject::FLAG_MARKED);
-                if (!(current->next_in_generation = saved_head))
+                u64 dead = m_bits[i].dead;
+                std::size_t index;
+
+                if (i == m_finalize_cursor / 64)
                 {
-                    saved_tail = current;
+                    dead &= ~static_cast<u64>(0) << (m_finalize_cursor % 64);
                 }
-                saved_head = current;
-            } else {
-#if defined(TEMPEARLY_GC_DEBUG)
-                ++destroyed_count;
-#endif
-                delete object;
-                current->block->MarkAsFree(current);
+                if (!dead)
+                {
+                    continue;
+                }
+                index = i * 64 + bit_scan(dead);
+                m_finalize_cursor = index + 1;
+                delete GetObject(index);
+
+                return true;
             }
-        }
-        if (saved_tail)
-        {
-            saved_tail->next_in_generation = old.head;
-            old.head = saved_head;
-        }
-#if defined(TEMPEARLY_GC_DEBUG)
-        std::fprintf(
-            stderr,
-            "GC: %d objects trashed, %d remain\n",
-            destroyed_count,
-            saved_count
-        );
-#endif
-    }
+            m_finalize_cursor = m_cursor;
 
-    CountedObject::CountedObject()
-        : m_flags(0)
-        , m_reference_count(0) {}
+            return false;
+        }
 
-    CountedObject::~CountedObject() {}
+        void Block::Release(FreeSlot*& free_head)
+        {
+            const std::size_t word_count = GetWordCount();
 
-    void CountedObject::Mark()
-    {
-        SetFlag(FLAG_MARKED);
-    }
+            for (std::size_t i = 0; i < word_count; ++i)
+            {
+                Bits& bits = m_bits[i];
+                u64 dead = bits.dead;
 
-    void* CountedObject::operator new(std::size_t size)
-    {
-        const std::size_t remainder = size % 8;
-        Record* record = nullptr;
+                if (!dead)
+                {
+                    continue;
+                }
+                bits.allocated &= ~dead;
+                bits.dead = 0;
+                m_used_count -= bit_count(dead);
+                for (; dead; dead &= dead - 1)
+                {
+                    FreeSlot* slot = reinterpret_cast<FreeSlot*>(GetObject(i * 64 + bit_scan(dead)));
 
-        if (remainder)
-        {
-            size += 8 - remainder;
+                    slot->next = free_head;
+                    free_head = slot;
+                }
+            }
+            m_finalize_cursor = 0;
         }
-        for (int i = 0; i < 3; ++i)
+
+        void Block::Drain(FreeSlot*& free_head)
         {
-            if (++gc_generation[i].counter < gc_generation[i].threshold)
-            {
-                break;
-            }
-#if defined(TEMPEARLY_GC_DEBUG)
-            std::fprintf(
-                stderr,
-                "GC: Generation %d reached threshold.\n",
-                i
-            );
-#endif
-            gc_generation[i].counter = 0;
-            gc_mark(gc_generation[i]);
-            if (i + 1 < 3)
+            m_cursor = m_object_count;
+            for (std::size_t i = 0; i < m_object_count; ++i)
             {
-                gc_sweep(gc_generation[i], gc_generation[i + 1]);
-            } else {
-                gc_sweep(gc_generation[i], gc_generation[i]);
+                if (!((m_bits[i / 64].allocated >> (i % 64)) & 1))
+                {
+                    FreeSlot* slot = reinterpret_cast<FreeSlot*>(GetObject(i));
+
+                    slot->next = free_head;
+                    free_head = slot;
+                }
             }
         }
-        for (Block* block = gc_block_head; block; block = block->GetNext())
+
+        void Block::Unmark()
         {
-            if ((record = block->Allocate(size)))
+            const std::size_t word_count = GetWordCount();
+
+            for (std::size_t i = 0; i < word_count; ++i)
             {
-                break;
+                m_bits[i].marked = 0;
             }
         }
-        if (!record)
+
+        void Block::Reset(std::size_t size_class, std::size_t object_size)
         {
-            gc_block_head = new Block(gc_block_head);
-            if (!(record = gc_block_head->Allocate(size)))
+            m_size_class = size_class;
+            m_object_size = object_size;
+            m_objects = reinterpret_cast<byte*>(this) + kHeaderSize;
+            m_reciprocal = ((static_cast<u64>(1) << 32) + object_size - 1) / object_size;
+            if (object_size > kLargeSizeLimit)
             {
-                throw std::bad_alloc();
+                m_object_count = 1;
+            } else {
+                m_object_count = (m_memory_size - kHeaderSize) / object_size;
             }
+            m_cursor = 0;
+            m_used_count = 0;
+            m_finalize_cursor = 0;
+            m_pending = false;
+            m_pending_next = nullptr;
+            std::memset(static_cast<void*>(m_bits), 0, sizeof(Bits) * ((m_object_count + 63) / 64));
         }
-        record->next_in_generation = gc_generation[0].head;
-        gc_generation[0].head = record;
+    }
 
-        return static_cast<void*>(record->pointer);
+    // Every thread has a heap of it's own, so none of the state below needs
+    // to be synchronized. Objects must never be shared between threads.
+
+    /** Pointer to latest allocated block of memory. */
+    static thread_local Block* gc_block_head = nullptr;
+
+    /** Allocation state of each size class. */
+    static thread_local SizeClass gc_size_class[kSizeClassCount];
+
+    static thread_local Generation gc_generation[3] =
+    {
+        { 0, 0 },
+        { 0, 0 },
+        { 0, 0 }
+    };
+    /**
+     * Configured threshold of the youngest generation when adaptive
+     * thresholds are in use, zero otherwise.
+     */
+    static thread_local int gc_adaptive_base = 0;
+    /** Number of objects finalized at a single safepoint, or zero for all. */
+    static thread_local int gc_finalize_budget = 0;
+
+    /** Blocks which contain objects still waiting to be finalized. */
+    static thread_local Block* gc_pending_head = nullptr;
+    /** Blocks which contain finalized objects that cannot be reused yet. */
+    static thread_local Block* gc_finalized_head = nullptr;
+
+    /** Number of nested arenas currently active. */
+    static thread_local int gc_arena_depth = 0;
+    /** Allocation state of each size class inside the arena. */
+    static thread_local SizeClass gc_arena_size_class[kSizeClassCount];
+    /** Pointer to the latest block allocated for the arena. */
+    static thread_local Block* gc_arena_block_head = nullptr;
+    /** Number of blocks allocated for the arena since last collection. */
+    static thread_local std::size_t gc_arena_block_count = 0;
+    /**
+     * Amount of memory allocated from the large object space inside the
+     * arena, which has not yet been added to the block count.
+     */
+    static thread_local std::size_t gc_arena_large_size = 0;
+
+    /** Blocks of objects in the large object space. */
+    static thread_local Block* gc_large_head = nullptr;
+
+    /** Empty blocks kept around for reuse. */
+    static thread_local Block* gc_spare_head = nullptr;
+    /** Number of blocks in the spare list. */
+    static thread_local std::size_t gc_spare_count = 0;
+
+    /** Whether allocations are being profiled. */
+    static thread_local bool gc_profiling = false;
+    /** Line number of the statement being executed. */
+    static thread_local int gc_profile_line = 0;
+    /** Allocation counters of each class, keyed by mangled class name. */
+    static thread_local Dictionary<ProfileCounter> gc_profile_classes;
+    /** Allocation counters of each source code line. */
+    static thread_local Vector<ProfileCounter> gc_profile_lines;
+    /**
+     * Objects whose classes have not been counted yet. Classes of objects
+     * cannot be determined when they are allocated, because they have not
+     * been constructed yet, so they are counted afterwards at safepoints.
+     */
+    static thread_local CountedObject** gc_profile_objects = nullptr;
+    /** Number of objects whose classes have not been counted yet. */
+    static thread_local std::size_t gc_profile_object_count = 0;
+    /** Capacity of the array of objects whose classes are not counted. */
+    static thread_local std::size_t gc_profile_object_capacity = 0;
+
+    /** Counters collected for Heap::GetStatistics(). */
+    static thread_local Heap::Statistics gc_statistics;
+    /** Time when the latest collection was started, in microseconds. */
+    static thread_local u64 gc_last_collection_time = 0;
+    /** Number of bytes allocated when the latest collection was started. */
+    static thread_local u64 gc_last_collection_allocated = 0;
+
+    /**
+     * Returns current value of monotonic clock in microseconds.
+     */
+    static inline u64 gc_clock()
+    {
+        return static_cast<u64>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()
+            ).count()
+        );
     }
 
-    void CountedObject::operator delete(void*) {}
+    /**
+     * Called when a collection is started. Returns start time of the
+     * collection, which is later passed to gc_collection_end().
+     */
+    static u64 gc_collection_begin()
+    {
+        const u64 now = gc_clock();
+
+        if (gc_last_collection_time && now > gc_last_collection_time)
+        {
+            gc_statistics.allocation_rate =
+                (gc_statistics.allocated_bytes - gc_last_collection_allocated)
+                * 1000000
+                / (now - gc_last_collection_time);
+        }
+        gc_last_collection_time = now;
+        gc_last_collection_allocated = gc_statistics.allocated_bytes;
+
+        return now;
+    }
+
+    /**
+     * Records duration of a collection which was started at given time.
+     */
+    static void gc_collection_end(u64 start)
+    {
+        const u64 pause = gc_clock() - start;
+        std::size_t bucket = 0;
+
+        for (u64 limit = 10; pause >= limit && bucket + 1 < Heap::kPauseBucketCount; limit *= 10)
+        {
+            ++bucket;
+        }
+        ++gc_statistics.pause_histogram[bucket];
+        gc_statistics.pause_total += pause;
+        if (pause > gc_statistics.pause_max)
+        {
+            gc_statistics.pause_max = pause;
+        }
+    }
+
+    /**
+     * Takes an empty block from the spare list, or allocates a new one if
+     * the spare list is empty, and prepares it to serve given size class.
+     */
+    static Block* gc_acquire_block(Block* next, std::size_t index)
+    {
+        Block* block = gc_spare_head;
+
+        if (block)
+        {
+            gc_spare_head = block->GetNext();
+            --gc_spare_count;
+        } else {
+            byte* data = block_memory_allocate(BlockHeader::kBlockSize);
+
+            if (!data)
+            {
+                throw std::bad_alloc();
+            }
+            block = new (static_cast<void*>(data)) Block(BlockHeader::kBlockSize);
+        }
+        block->Reset(index, size_class_object_size(index));
+        block->SetNext(next);
+
+        return block;
+    }
+
+    /**
+     * Puts a block which no longer contains any objects into the spare list,
+     * or returns it's memory to the operating system if the spare list has
+     * already reached the retention watermark. Returns true in the latter
+     * case.
+     */
+    static bool gc_retire_block(Block* block)
+    {
+        if (gc_spare_count < TEMPEARLY_GC_RETAIN_BLOCKS)
+        {
+            block->SetNext(gc_spare_head);
+            gc_spare_head = block;
+            ++gc_spare_count;
+
+            return false;
+        }
+        block_memory_release(reinterpret_cast<byte*>(block), block->GetMemorySize());
+
+        return true;
+    }
+
+    /**
+     * Takes a slot of given size class from the free list or bumps it from
+     * the current block of the size class, acquiring new block when needed.
+     */
+    static void* gc_allocate_slot(SizeClass& size_class,
+                                  std::size_t index,
+                                  Block*& block_head)
+    {
+        FreeSlot* slot;
+        void* pointer;
+
+        if ((slot = size_class.free_head))
+        {
+            size_class.free_head = slot->next;
+
+            return static_cast<void*>(slot);
+        }
+        else if (!size_class.block || !(pointer = size_class.block->Allocate()))
+        {
+            block_head = size_class.block = gc_acquire_block(block_head, index);
+            if (!(pointer = size_class.block->Allocate()))
+            {
+                throw std::bad_alloc();
+            }
+        }
+
+        return pointer;
+    }
+
+    /**
+     * Marks objects in given list of blocks which are referenced by handles,
+     * along with everything reachable from them. Objects which are waiting
+     * for finalization are skipped.
+     */
+    static void gc_mark_roots(Block* head)
+    {
+        for (Block* block = head; block; block = block->GetNext())
+        {
+            const std::size_t word_count = block->GetWordCount();
+
+            for (std::size_t i = 0; i < word_count; ++i)
+            {
+                const BlockHeader::Bits& bits = block->GetBits(i);
+                u64 candidates = bits.allocated & ~bits.dead & ~bits.marked;
+
+                for (; candidates; candidates &= candidates - 1)
+                {
+                    const std::size_t bit = bit_scan(candidates);
+                    CountedObject* object;
+
+                    // Marking an object may have marked the following ones
+                    // in the same word as well.
+                    if ((bits.marked >> bit) & 1)
+                    {
+                        continue;
+                    }
+                    object = block->GetObject(i * 64 + bit);
+                    if (object->GetReferenceCount())
+                    {
+                        object->Mark();
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Clears mark bits of objects in given list of blocks.
+     */
+    static void gc_unmark_blocks(Block* head)
+    {
+        for (Block* block = head; block; block = block->GetNext())
+        {
+            block->Unmark();
+        }
+    }
+
+    /**
+     * Marks everything reachable from referenced objects. Older generations
+     * have to be traversed as well, because objects in them may point to
+     * younger objects through raw pointers.
+     */
+    static void gc_mark()
+    {
+        gc_mark_roots(gc_block_head);
+        gc_mark_roots(gc_arena_block_head);
+        gc_mark_roots(gc_large_head);
+    }
+
+    /**
+     * Clears mark bits of every object in the heap.
+     */
+    static void gc_unmark()
+    {
+        gc_unmark_blocks(gc_block_head);
+        gc_unmark_blocks(gc_arena_block_head);
+        gc_unmark_blocks(gc_large_head);
+    }
+
+    /**
+     * Adds given block into the list of blocks which contain objects waiting
+     * for finalization, unless it's there already.
+     */
+    static void gc_pending_insert(Block* block)
+    {
+        if (!block->IsPending())
+        {
+            block->SetPending(true);
+            block->SetPendingNext(gc_pending_head);
+            gc_pending_head = block;
+        }
+    }
+
+    /**
+     * Allocates a block for an object of given size from the large object
+     * space. Each object gets a block of it's own, so that it's memory is
+     * returned to the operating system as soon as the object is destroyed.
+     */
+    static Block* gc_large_allocate(std::size_t size)
+    {
+        const std::size_t object_size = (size + 15) & ~static_cast<std::size_t>(15);
+        const std::size_t memory_size = block_memory_round(kHeaderSize + object_size);
+        byte* data = block_memory_allocate(memory_size);
+        Block* block;
+
+        if (!data)
+        {
+            throw std::bad_alloc();
+        }
+        block = new (static_cast<void*>(data)) Block(memory_size);
+        block->Reset(kSizeClassCount, object_size);
+        block->SetNext(gc_large_head);
+        gc_large_head = block;
+
+        return block;
+    }
+
+    /**
+     * Returns memory of a block from the large object space whose object has
+     * been destroyed.
+     */
+    static void gc_large_release(Block* block)
+    {
+        block_memory_release(reinterpret_cast<byte*>(block), block->GetMemorySize());
+    }
+
+    /**
+     * Flags unmarked objects of the large object space as finalizing and
+     * queues them for finalization. Objects in the large object space do not
+     * age, so they are examined in every collection.
+     */
+    static void gc_large_collect()
+    {
+        for (Block* block = gc_large_head; block; block = block->GetNext())
+        {
+            BlockHeader::Bits& bits = block->GetBits(0);
+
+            if (!(bits.marked & 1) && !(bits.dead & 1))
+            {
+                bits.dead |= 1;
+                block->GetObject(0)->SetFlag(CountedObject::FLAG_FINALIZING);
+                gc_pending_insert(block);
+            }
+        }
+    }
+
+    /**
+     * Removes blocks which no longer contain any objects from the heap. Their
+     * slots are taken out of the free lists first, after which the blocks
+     * are either kept in the spare list or released.
+     */
+    static void gc_release_empty_blocks()
+    {
+        bool affected[kSizeClassCount] = { false };
+        Block* empty_head = nullptr;
+        Block* previous = nullptr;
+        Block* block = gc_block_head;
+        Block* next;
+
+        for (; block; block = next)
+        {
+            next = block->GetNext();
+            if (block->GetUsedCount())
+            {
+                previous = block;
+                continue;
+            }
+            if (previous)
+            {
+                previous->SetNext(next);
+            } else {
+                gc_block_head = next;
+            }
+            if (gc_size_class[block->GetSizeClass()].block == block)
+            {
+                gc_size_class[block->GetSizeClass()].block = nullptr;
+            }
+            affected[block->GetSizeClass()] = true;
+            block->SetNext(empty_head);
+            empty_head = block;
+        }
+        if (!empty_head)
+        {
+            return;
+        }
+        for (std::size_t i = 0; i < kSizeClassCount; ++i)
+        {
+            FreeSlot** slot;
+
+            if (!affected[i])
+            {
+                continue;
+            }
+            for (slot = &gc_size_class[i].free_head; *slot;)
+            {
+                if (Block::Of(*slot)->GetUsedCount())
+                {
+                    slot = &(*slot)->next;
+                } else {
+                    *slot = (*slot)->next;
+                }
+            }
+        }
+        for (block = empty_head; block; block = next)
+        {
+            next = block->GetNext();
+            gc_retire_block(block);
+        }
+    }
+
+    /**
+     * Releases slots of finalized objects into the free lists, and blocks of
+     * finalized objects in the large object space back to the operating
+     * system.
+     */
+    static void gc_release_finalized()
+    {
+        Block* block;
+        Block* next;
+        Block* previous = nullptr;
+
+        for (block = gc_finalized_head; block; block = next)
+        {
+            next = block->GetPendingNext();
+            block->SetPending(false);
+            block->SetPendingNext(nullptr);
+            if (block->GetSizeClass() < kSizeClassCount)
+            {
+                block->Release(gc_size_class[block->GetSizeClass()].free_head);
+            }
+        }
+        gc_finalized_head = nullptr;
+        for (block = gc_large_head; block; block = next)
+        {
+            next = block->GetNext();
+            if (!(block->GetBits(0).dead & 1))
+            {
+                previous = block;
+                continue;
+            }
+            if (previous)
+            {
+                previous->SetNext(next);
+            } else {
+                gc_large_head = next;
+            }
+            gc_large_release(block);
+        }
+    }
+
+    /**
+     * Destroys at most given number of objects waiting for finalization, or
+     * all of them if the budget is zero. Slots are released for reuse only
+     * after every pending object has been finalized, because destructors of
+     * the remaining objects may still inspect them.
+     */
+    static void gc_finalize_pending(std::size_t budget)
+    {
+        Block* block;
+
+        while ((block = gc_pending_head))
+        {
+            if (!block->FinalizeNext())
+            {
+                gc_pending_head = block->GetPendingNext();
+                block->SetPendingNext(gc_finalized_head);
+                gc_finalized_head = block;
+                continue;
+            }
+            if (budget && !--budget)
+            {
+                break;
+            }
+        }
+        if (!gc_pending_head && gc_finalized_head)
+        {
+            gc_release_finalized();
+            gc_release_empty_blocks();
+        }
+    }
+
+    /**
+     * Counts allocation of given object towards the source code line which
+     * is currently being executed, and remembers the object so that it's
+     * class can be counted once it has been constructed.
+     */
+    static void gc_profile_allocation(CountedObject* object, std::size_t size)
+    {
+        const std::size_t line = gc_profile_line > 0 ? gc_profile_line : 0;
+
+        while (gc_profile_lines.GetSize() <= line)
+        {
+            const ProfileCounter counter = { 0, 0 };
+
+            gc_profile_lines.PushBack(counter);
+        }
+        ++gc_profile_lines[line].objects;
+        gc_profile_lines[line].bytes += size;
+        if (gc_profile_object_count >= gc_profile_object_capacity)
+        {
+            CountedObject** old = gc_profile_objects;
+
+            gc_profile_object_capacity = gc_profile_object_capacity ? gc_profile_object_capacity * 2 : 256;
+            gc_profile_objects = Memory::Allocate<CountedObject*>(gc_profile_object_capacity);
+            if (!gc_profile_objects)
+            {
+                throw std::bad_alloc();
+            }
+            Memory::Copy<CountedObject*>(gc_profile_objects, old, gc_profile_object_count);
+            Memory::Unallocate<CountedObject*>(old);
+        }
+        gc_profile_objects[gc_profile_object_count++] = object;
+    }
+
+    /**
+     * Counts classes of objects allocated since the previous call. Must be
+     * called while every object is fully constructed and before any of them
+     * are destroyed.
+     */
+    static void gc_profile_resolve()
+    {
+        for (std::size_t i = 0; i < gc_profile_object_count; ++i)
+        {
+            CountedObject* object = gc_profile_objects[i];
+            const String name = typeid(*object).name();
+            Dictionary<ProfileCounter>::Entry* entry = gc_profile_classes.Find(name);
+
+            if (!entry)
+            {
+                const ProfileCounter counter = { 0, 0 };
+
+                gc_profile_classes.Insert(name, counter);
+                entry = gc_profile_classes.Find(name);
+            }
+            ++entry->GetValue().objects;
+            entry->GetValue().bytes += Block::Of(object)->GetObjectSize();
+        }
+        gc_profile_object_count = 0;
+    }
+
+    /**
+     * Converts mangled class name into human readable form.
+     */
+    static String gc_profile_demangle(const String& mangled)
+    {
+#if defined(__GNUC__)
+        int status;
+        char* name = abi::__cxa_demangle(mangled.Encode().c_str(), nullptr, nullptr, &status);
+
+        if (name)
+        {
+            const String result = name;
+
+            std::free(static_cast<void*>(name));
+
+            return result;
+        }
+#endif
+
+        return mangled;
+    }
+
+    /**
+     * Appends given allocation counter as JSON object into the buffer.
+     */
+    static void gc_profile_write_counter(StringBuilder& buffer, const ProfileCounter& counter)
+    {
+        buffer << "{\"objects\":"
+               << String::FromU64(counter.objects)
+               << ",\"bytes\":"
+               << String::FromU64(counter.bytes)
+               << '}';
+    }
+
+    /**
+     * Reads integer which is not less than given minimum from environment
+     * variable with given name into given slot. Slot is left untouched if
+     * the variable is missing or invalid.
+     */
+    static void gc_getenv_int(const char* name, int& slot, int minimum = 1)
+    {
+        const char* value = std::getenv(name);
+        char* end;
+        long result;
+
+        if (!value || !*value)
+        {
+            return;
+        }
+        result = std::strtol(value, &end, 10);
+        if (!*end && result >= minimum && result <= INT_MAX)
+        {
+            slot = static_cast<int>(result);
+        }
+    }
+
+    /**
+     * Returns collector options from compile time defaults, overridden by
+     * the environment.
+     */
+    static Heap::Options gc_default_options()
+    {
+        Heap::Options options =
+        {
+            {
+                TEMPEARLY_GC_THRESHOLD0,
+                TEMPEARLY_GC_THRESHOLD1,
+                TEMPEARLY_GC_THRESHOLD2
+            },
+            TEMPEARLY_GC_ADAPTIVE != 0,
+            TEMPEARLY_GC_PROFILE != 0,
+            TEMPEARLY_GC_SWEEP_BUDGET
+        };
+        const char* adaptive = std::getenv("TEMPEARLY_GC_ADAPTIVE");
+        const char* profile = std::getenv("TEMPEARLY_GC_PROFILE");
+
+        gc_getenv_int("TEMPEARLY_GC_THRESHOLD0", options.thresholds[0]);
+        gc_getenv_int("TEMPEARLY_GC_THRESHOLD1", options.thresholds[1]);
+        gc_getenv_int("TEMPEARLY_GC_THRESHOLD2", options.thresholds[2]);
+        gc_getenv_int("TEMPEARLY_GC_SWEEP_BUDGET", options.finalize_budget, 0);
+        if (adaptive && *adaptive)
+        {
+            options.adaptive = std::strcmp(adaptive, "0") != 0;
+        }
+        if (profile && *profile)
+        {
+            options.profile = std::strcmp(profile, "0") != 0;
+        }
+
+        return options;
+    }
+
+    /**
+     * Returns collector options shared by all threads.
+     */
+    static Heap::Options& gc_options()
+    {
+        static Heap::Options options = gc_default_options();
+
+        return options;
+    }
+
+    /**
+     * Applies given collector options to the heap of current thread.
+     */
+    static void gc_configure(const Heap::Options& options)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            gc_generation[i].threshold = options.thresholds[i] > 0 ? options.thresholds[i] : 1;
+        }
+        gc_adaptive_base = options.adaptive ? gc_generation[0].threshold : 0;
+        gc_finalize_budget = options.finalize_budget > 0 ? options.finalize_budget : 0;
+        if (!options.profile)
+        {
+            gc_profile_object_count = 0;
+        }
+        gc_profiling = options.profile;
+    }
+
+    /**
+     * Adjusts threshold of the youngest generation after it's collection.
+     * When only few objects survive, collecting more seldom costs nothing
+     * but memory, so the threshold is doubled up to a limit. When many
+     * survive it is halved back towards the configured value.
+     */
+    static void gc_adapt(std::size_t saved_count, std::size_t destroyed_count)
+    {
+        const std::size_t total = saved_count + destroyed_count;
+        int& threshold = gc_generation[0].threshold;
+
+        if (!total)
+        {
+            return;
+        }
+        if (saved_count * 8 < total)
+        {
+            if (threshold <= gc_adaptive_base * (TEMPEARLY_GC_ADAPTIVE_LIMIT / 2))
+            {
+                threshold *= 2;
+            }
+        }
+        else if (saved_count * 2 > total && threshold > gc_adaptive_base)
+        {
+            threshold = threshold / 2 > gc_adaptive_base ? threshold / 2 : gc_adaptive_base;
+        }
+    }
+
+
+    /**
+     * Flags unmarked objects of given generation as finalizing and queues
+     * them for finalization, promoting the rest into the next generation.
+     * Unreachable objects are flagged as finalizing immediately, but their
+     * destructors are run in slices by later safepoints, so that a single
+     * collection does not stall the script for the duration of the entire
+     * sweep. Returns number of objects which survived.
+     */
+    static std::size_t gc_sweep(int generation, std::size_t& destroyed_count)
+    {
+        std::size_t saved_count = 0;
+
+        for (Block* block = gc_block_head; block; block = block->GetNext())
+        {
+            const std::size_t word_count = block->GetWordCount();
+            bool found = false;
+
+            for (std::size_t i = 0; i < word_count; ++i)
+            {
+                BlockHeader::Bits& bits = block->GetBits(i);
+                u64 members;
+                u64 dead;
+
+                if (generation == 0)
+                {
+                    members = bits.young;
+                    bits.young = 0;
+                    bits.middle |= members & bits.marked;
+                }
+                else if (generation == 1)
+                {
+                    members = bits.middle;
+                    bits.middle = 0;
+                } else {
+                    members = bits.allocated & ~bits.young & ~bits.middle & ~bits.dead;
+                }
+                if (!members)
+                {
+                    continue;
+                }
+                saved_count += bit_count(members & bits.marked);
+                if (!(dead = members & ~bits.marked))
+                {
+                    continue;
+                }
+                destroyed_count += bit_count(dead);
+                bits.dead |= dead;
+                found = true;
+                for (; dead; dead &= dead - 1)
+                {
+                    block->GetObject(i * 64 + bit_scan(dead))->SetFlag(CountedObject::FLAG_FINALIZING);
+                }
+            }
+            if (found)
+            {
+                gc_pending_insert(block);
+            }
+        }
+#if defined(TEMPEARLY_GC_DEBUG)
+        std::fprintf(
+            stderr,
+            "GC: %zu objects trashed, %zu remain\n",
+            destroyed_count,
+            saved_count
+        );
+#endif
+
+        return saved_count;
+    }
+
+    /**
+     * Destroys unreachable objects of the arena and the large object space.
+     * Every such object is flagged as finalizing before any destructor is
+     * called, so that destructors can avoid touching other objects which are
+     * being destroyed as well. Slots of the destroyed objects are released
+     * into free lists of the arena. Returns number of destroyed objects.
+     */
+    static std::size_t gc_arena_sweep()
+    {
+        std::size_t destroyed_count = 0;
+        Block* dead_head = nullptr;
+        Block* previous = nullptr;
+        Block* block;
+        Block* next;
+
+        gc_mark();
+        for (block = gc_arena_block_head; block; block = block->GetNext())
+        {
+            const std::size_t word_count = block->GetWordCount();
+
+            for (std::size_t i = 0; i < word_count; ++i)
+            {
+                BlockHeader::Bits& bits = block->GetBits(i);
+                u64 dead = bits.allocated & ~bits.marked;
+
+                destroyed_count += bit_count(dead);
+                bits.dead = dead;
+                for (; dead; dead &= dead - 1)
+                {
+                    block->GetObject(i * 64 + bit_scan(dead))->SetFlag(CountedObject::FLAG_FINALIZING);
+                }
+            }
+        }
+        // Objects in the large object space which are already waiting for
+        // finalization are left alone.
+        for (block = gc_large_head; block; block = next)
+        {
+            const BlockHeader::Bits& bits = block->GetBits(0);
+
+            next = block->GetNext();
+            if ((bits.marked & 1) || (bits.dead & 1))
+            {
+                previous = block;
+                continue;
+            }
+            if (previous)
+            {
+                previous->SetNext(next);
+            } else {
+                gc_large_head = next;
+            }
+            ++destroyed_count;
+            block->GetObject(0)->SetFlag(CountedObject::FLAG_FINALIZING);
+            block->SetNext(dead_head);
+            dead_head = block;
+        }
+        gc_unmark();
+        if (!destroyed_count)
+        {
+            return 0;
+        }
+        for (block = gc_arena_block_head; block; block = block->GetNext())
+        {
+            while (block->FinalizeNext());
+        }
+        for (block = dead_head; block; block = block->GetNext())
+        {
+            delete block->GetObject(0);
+        }
+        for (block = gc_arena_block_head; block; block = block->GetNext())
+        {
+            block->Release(gc_arena_size_class[block->GetSizeClass()].free_head);
+        }
+        for (block = dead_head; block; block = next)
+        {
+            next = block->GetNext();
+            gc_large_release(block);
+        }
+
+        return destroyed_count;
+    }
+
+    /**
+     * Collects garbage from given generation of the shared heap and promotes
+     * the survivors into the next one.
+     */
+    static void gc_collect(int generation)
+    {
+        const u64 start = gc_collection_begin();
+        std::size_t saved_count;
+        std::size_t destroyed_count = 0;
+
+#if defined(TEMPEARLY_GC_DEBUG)
+        std::fprintf(
+            stderr,
+            "GC: Generation %d reached threshold.\n",
+            generation
+        );
+#endif
+        gc_generation[generation].counter = 0;
+        // Garbage left over from the previous collection is finalized before
+        // more is found, so that it cannot pile up.
+        if (generation == 0)
+        {
+            gc_finalize_pending(0);
+        }
+        gc_mark();
+        saved_count = gc_sweep(generation, destroyed_count);
+        if (generation + 1 < 3)
+        {
+            ++gc_generation[generation + 1].counter;
+        }
+        gc_large_collect();
+        gc_unmark();
+        if (generation == 0 && gc_adaptive_base)
+        {
+            gc_adapt(saved_count, destroyed_count);
+        }
+        ++gc_statistics.collections[generation];
+        gc_collection_end(start);
+    }
+
+    /**
+     * Collects each generation of the shared heap which has reached its
+     * threshold, starting from the youngest one.
+     */
+    static void gc_collect_due()
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (gc_generation[i].counter < gc_generation[i].threshold)
+            {
+                break;
+            }
+            gc_collect(i);
+        }
+    }
+
+    /**
+     * Collects garbage from the arena without releasing it. This is only
+     * done when a single request allocates an excessive amount of memory.
+     */
+    static void gc_arena_collect()
+    {
+        const u64 start = gc_collection_begin();
+
+        gc_arena_sweep();
+        gc_arena_block_count = 0;
+        ++gc_statistics.arena_collections;
+        gc_collection_end(start);
+    }
+
+    /**
+     * Releases the arena. Objects which are still reachable stay where they
+     * are and the blocks containing them are handed over to the shared heap,
+     * which makes them part of the oldest generation. Everything else is
+     * destroyed and the blocks which became empty are kept for reuse by the
+     * next arena.
+     */
+    static void gc_arena_release()
+    {
+        Block* block;
+        Block* next;
+        bool released = false;
+
+        // Handles held by destroyed objects may have been the only thing
+        // keeping other objects alive, so the arena is swept until no more
+        // garbage is found. Otherwise such objects would end up in the oldest
+        // generation, which is rarely collected.
+        while (gc_arena_sweep());
+        for (std::size_t i = 0; i < kSizeClassCount; ++i)
+        {
+            gc_arena_size_class[i].block = nullptr;
+            gc_arena_size_class[i].free_head = nullptr;
+        }
+        for (block = gc_arena_block_head; block; block = next)
+        {
+            next = block->GetNext();
+            if (block->GetUsedCount())
+            {
+                // Free slots of blocks which are handed over to the shared
+                // heap are reused through it's free lists.
+                block->Drain(gc_size_class[block->GetSizeClass()].free_head);
+                block->SetNext(gc_block_head);
+                gc_block_head = block;
+            }
+            else if (gc_retire_block(block))
+            {
+                released = true;
+            }
+        }
+        gc_arena_block_head = nullptr;
+        gc_arena_block_count = 0;
+#if defined(__GLIBC__)
+        // Memory used by strings and containers of the destroyed objects is
+        // returned to the operating system as well, after an exceptionally
+        // large request.
+        if (released)
+        {
+            ::malloc_trim(0);
+        }
+#endif
+    }
+
+    /**
+     * Allocates a slot from the arena, keeping track of the number of blocks
+     * taken into use by the arena.
+     */
+    static void* gc_arena_allocate(std::size_t index)
+    {
+        SizeClass& size_class = gc_arena_size_class[index];
+        FreeSlot* slot;
+        void* pointer;
+
+        if ((slot = size_class.free_head))
+        {
+            size_class.free_head = slot->next;
+
+            return static_cast<void*>(slot);
+        }
+        else if (size_class.block && (pointer = size_class.block->Allocate()))
+        {
+            return pointer;
+        }
+        ++gc_arena_block_count;
+
+        return gc_allocate_slot(size_class, index, gc_arena_block_head);
+    }
+
+    CountedObject::CountedObject()
+        : m_flags(0)
+        , m_reference_count(0) {}
+
+    CountedObject::~CountedObject() {}
+
+    void CountedObject::Mark()
+    {
+        BlockHeader* block = BlockHeader::Of(this);
+
+        block->SetMarked(block->IndexOf(this));
+    }
+
+    void* CountedObject::operator new(std::size_t size)
+    {
+        std::size_t index;
+        void* pointer;
+
+        ++gc_statistics.allocated_objects;
+        gc_statistics.allocated_bytes += size;
+        if (size > kLargeSizeLimit)
+        {
+            Block* block;
+
+            // Large objects count as multiple allocations towards the next
+            // collection, depending on how much memory they occupy.
+            if (gc_arena_depth > 0)
+            {
+                gc_arena_large_size += size;
+                gc_arena_block_count += gc_arena_large_size / BlockHeader::kBlockSize;
+                gc_arena_large_size %= BlockHeader::kBlockSize;
+            } else {
+                gc_generation[0].counter += static_cast<int>(size / kLargeSizeLimit);
+            }
+            block = gc_large_allocate(size);
+            pointer = block->Allocate();
+            block->Occupy(pointer, false);
+            if (gc_profiling)
+            {
+                gc_profile_allocation(static_cast<CountedObject*>(pointer), size);
+            }
+
+            return pointer;
+        }
+        index = size_class_index(size);
+        if (gc_arena_depth > 0)
+        {
+            pointer = gc_arena_allocate(index);
+            Block::Of(pointer)->Occupy(pointer, false);
+        } else {
+            ++gc_generation[0].counter;
+            pointer = gc_allocate_slot(gc_size_class[index], index, gc_block_head);
+            Block::Of(pointer)->Occupy(pointer, true);
+        }
+        if (gc_profiling)
+        {
+            gc_profile_allocation(static_cast<CountedObject*>(pointer), size_class_object_size(index));
+        }
+
+        return pointer;
+    }
+
+    void CountedObject::operator delete(void*) {}
+
+    void Heap::Safepoint()
+    {
+        if (!gc_generation[0].threshold)
+        {
+            gc_configure(gc_options());
+        }
+        if (gc_profiling)
+        {
+            gc_profile_resolve();
+        }
+        if (gc_pending_head)
+        {
+            gc_finalize_pending(gc_finalize_budget);
+        }
+        if (gc_arena_depth > 0)
+        {
+            if (gc_arena_block_count >= TEMPEARLY_GC_ARENA_LIMIT)
+            {
+                gc_arena_collect();
+            }
+
+            return;
+        }
+        gc_collect_due();
+    }
+
+    bool Heap::IsProfiling()
+    {
+        return gc_profiling;
+    }
+
+    void Heap::SetAllocationSite(int line)
+    {
+        gc_profile_line = line;
+    }
+
+    String Heap::GetProfile()
+    {
+        StringBuilder buffer;
+        bool first = true;
+
+        if (!gc_profiling)
+        {
+            return String();
+        }
+        gc_profile_resolve();
+        buffer << "{\"classes\":{";
+        for (const Dictionary<ProfileCounter>::Entry* entry = gc_profile_classes.GetFront(); entry; entry = entry->GetNext())
+        {
+            if (!first)
+            {
+                buffer << ',';
+            }
+            buffer << '"' << gc_profile_demangle(entry->GetName()) << "\":";
+            gc_profile_write_counter(buffer, entry->GetValue());
+            first = false;
+        }
+        buffer << "},\"lines\":{";
+        first = true;
+        for (std::size_t i = 0; i < gc_profile_lines.GetSize(); ++i)
+        {
+            if (!gc_profile_lines[i].objects)
+            {
+                continue;
+            }
+            if (!first)
+            {
+                buffer << ',';
+            }
+            buffer << '"' << String::FromU64(i) << "\":";
+            gc_profile_write_counter(buffer, gc_profile_lines[i]);
+            first = false;
+        }
+        buffer << "}}";
+        gc_profile_classes.Clear();
+        gc_profile_lines.Clear();
+
+        return buffer.ToString();
+    }
+
+    Heap::Options Heap::GetOptions()
+    {
+        return gc_options();
+    }
+
+    void Heap::SetOptions(const Options& options)
+    {
+        gc_options() = options;
+        gc_configure(options);
+    }
+
+    Heap::Statistics Heap::GetStatistics()
+    {
+        Statistics statistics = gc_statistics;
+        std::size_t used_bytes = 0;
+        Block* heads[2] = { gc_block_head, gc_arena_block_head };
+
+        statistics.blocks = 0;
+        statistics.spare_blocks = gc_spare_count;
+        statistics.live_objects = 0;
+        statistics.live_bytes = 0;
+        for (int i = 0; i < 2; ++i)
+        {
+            for (Block* block = heads[i]; block; block = block->GetNext())
+            {
+                ++statistics.blocks;
+                statistics.live_objects += block->GetUsedCount();
+                statistics.live_bytes += block->GetUsedCount() * block->GetObjectSize();
+            }
+        }
+        used_bytes = statistics.blocks * BlockHeader::kBlockSize;
+        statistics.large_objects = 0;
+        statistics.large_bytes = 0;
+        for (Block* block = gc_large_head; block; block = block->GetNext())
+        {
+            ++statistics.large_objects;
+            statistics.large_bytes += block->GetMemorySize();
+        }
+        if (!gc_generation[0].threshold)
+        {
+            gc_configure(gc_options());
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            statistics.thresholds[i] = gc_generation[i].threshold;
+        }
+        statistics.free_bytes = used_bytes - statistics.live_bytes;
+
+        return statistics;
+    }
+
+    void Heap::GetBlockStatistics(Vector<BlockStatistics>& slot)
+    {
+        Block* heads[2] = { gc_block_head, gc_arena_block_head };
+
+        for (int i = 0; i < 2; ++i)
+        {
+            for (Block* block = heads[i]; block; block = block->GetNext())
+            {
+                BlockStatistics statistics;
+
+                statistics.object_size = block->GetObjectSize();
+                statistics.live_objects = block->GetUsedCount();
+                statistics.live_bytes = statistics.live_objects * statistics.object_size;
+                statistics.free_bytes = BlockHeader::kBlockSize - statistics.live_bytes;
+                statistics.arena = i == 1;
+                slot.PushBack(statistics);
+            }
+        }
+    }
+
+    Arena::Arena()
+    {
+        ++gc_arena_depth;
+    }
+
+    Arena::~Arena()
+    {
+        if (!--gc_arena_depth)
+        {
+            if (gc_profiling)
+            {
+                gc_profile_resolve();
+            }
+            gc_arena_release();
+            // Safepoints inside arenas never reach the generational
+            // collections, so they are run once the arena has been released.
+            // Objects which survive an arena join the oldest generation,
+            // therefore each released arena also counts as a collection of
+            // the middle generation.
+            if (!gc_generation[0].threshold)
+            {
+                gc_configure(gc_options());
+            }
+            gc_collect_due();
+            if (++gc_generation[2].counter >= gc_generation[2].threshold)
+            {
+                gc_collect(2);
+            }
+        }
+    }
 }
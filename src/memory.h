@@ -8,6 +8,9 @@
 
 namespace tempearly
 {
+    class String;
+    template< class T > class Vector;
+
     /**
      * Contains various memory related utilities.
      */
@@ -232,8 +235,15 @@ namespace tempearly
          */
         Handle& operator=(Handle<T>&& that)
         {
-            m_pointer = that.m_pointer;
-            that.m_pointer = nullptr;
+            if (this != &that)
+            {
+                if (m_pointer)
+                {
+                    m_pointer->DecReferenceCount();
+                }
+                m_pointer = that.m_pointer;
+                that.m_pointer = nullptr;
+            }
 
             return *this;
         }
@@ -328,12 +338,97 @@ namespace tempearly
         T* m_pointer;
     };
 
+    /**
+     * Header of a memory block of the garbage collected heap. Blocks are
+     * aligned to their size, so the block containing an object can be found
+     * from the address of the object. State of the objects, including their
+     * mark bits, is kept in bitmaps of the header instead of the objects
+     * themselves, so that the collector can examine and reset it without
+     * touching the objects at all.
+     */
+    class BlockHeader
+    {
+    public:
+        /** Size and alignment of single memory block. */
+#if defined(TEMPEARLY_GC_HUGE_PAGES) && defined(TEMPEARLY_HAVE_SYS_MMAN_H)
+        static const std::size_t kBlockSize = 1024 * 1024 * 2;
+#else
+        static const std::size_t kBlockSize = 4096 * 32;
+#endif
+        /** Size of the smallest object which can be allocated. */
+        static const std::size_t kMinObjectSize = 16;
+        /** Number of bitmap words in the header. */
+        static const std::size_t kBitmapSize = kBlockSize / kMinObjectSize / 64;
+
+        /**
+         * State of 64 consecutive objects in the block, one bit per object
+         * in each word.
+         */
+        struct Bits
+        {
+            /** Objects which have been marked as reachable. */
+            u64 marked;
+            /** Slots which are occupied by an object. */
+            u64 allocated;
+            /** Objects in the youngest generation. */
+            u64 young;
+            /** Objects in the middle generation. */
+            u64 middle;
+            /** Unreachable objects which have not been released yet. */
+            u64 dead;
+        };
+
+        /**
+         * Returns header of the block which contains given object.
+         */
+        static inline BlockHeader* Of(const void* pointer)
+        {
+            return reinterpret_cast<BlockHeader*>(reinterpret_cast<std::size_t>(pointer) & ~(kBlockSize - 1));
+        }
+
+        /**
+         * Returns index of given object inside the block.
+         */
+        inline std::size_t IndexOf(const void* pointer) const
+        {
+            const u64 offset = static_cast<u64>(static_cast<const byte*>(pointer) - m_objects);
+
+            return static_cast<std::size_t>((offset * m_reciprocal) >> 32);
+        }
+
+        /**
+         * Returns true if object in given index has been marked.
+         */
+        inline bool IsMarked(std::size_t index) const
+        {
+            return (m_bits[index / 64].marked >> (index % 64)) & 1;
+        }
+
+        /**
+         * Marks object in given index.
+         */
+        inline void SetMarked(std::size_t index)
+        {
+            m_bits[index / 64].marked |= static_cast<u64>(1) << (index % 64);
+        }
+
+    protected:
+        /** Pointer to the first object in the block. */
+        byte* m_objects;
+        /**
+         * Reciprocal of the object size scaled by 2^32, used for calculating
+         * indexes of objects without division.
+         */
+        u64 m_reciprocal;
+        /** State of the objects contained by the block. */
+        Bits m_bits[kBitmapSize];
+    };
+
     class CountedObject
     {
     public:
         enum Flag
         {
-            FLAG_MARKED = 2,
             FLAG_FINALIZING = 4,
             FLAG_INSPECTING = 8
         };
@@ -371,7 +466,9 @@ namespace tempearly
          */
         inline bool IsMarked() const
         {
-            return (m_flags & FLAG_MARKED) != 0;
+            const BlockHeader* block = BlockHeader::Of(this);
+
+            return block->IsMarked(block->IndexOf(this));
         }
 
         /**
@@ -417,6 +514,203 @@ namespace tempearly
         unsigned int m_reference_count;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(CountedObject);
     };
+
+    /**
+     * Interface to the garbage collected heap. Each thread allocates from and
+     * collects a heap of it's own, which allows multiple interpreters to run
+     * concurrently in separate threads. Objects (and handles to them) must
+     * not be passed from one thread to another, because neither reference
+     * counting nor marking is synchronized.
+     */
+    class Heap
+    {
+    public:
+        /** Number of buckets in the collection pause histogram. */
+        static const std::size_t kPauseBucketCount = 6;
+
+        /**
+         * Tunable parameters of the garbage collector.
+         */
+        struct Options
+        {
+            /**
+             * Collection thresholds of each generation. Youngest generation is
+             * collected after given number of allocations and older ones after
+             * given number of collections in the preceding generation.
+             */
+            int thresholds[3];
+            /**
+             * Whether threshold of the youngest generation should be adjusted
+             * based on how many objects survive it's collections.
+             */
+            bool adaptive;
+            /**
+             * Whether allocations should be counted per class and per source
+             * code line.
+             */
+            bool profile;
+            /**
+             * Maximum number of unreachable objects finalized at a single
+             * safepoint. Remaining ones are left for following safepoints.
+             * Zero finalizes all of them at the next safepoint.
+             */
+            int finalize_budget;
+        };
+
+        /**
+         * Statistics of the garbage collected heap of current thread.
+         */
+        struct Statistics
+        {
+            /** Number of collections performed in each generation. */
+            u64 collections[3];
+            /** Number of collections performed inside arenas. */
+            u64 arena_collections;
+            /** Total time spent in collections, in microseconds. */
+            u64 pause_total;
+            /** Duration of the longest collection, in microseconds. */
+            u64 pause_max;
+            /**
+             * Histogram of collection durations. First bucket counts pauses
+             * shorter than 10 microseconds and each following bucket ten times
+             * longer ones, except the last one which counts everything else.
+             */
+            u64 pause_histogram[kPauseBucketCount];
+            /** Number of objects allocated since the thread was started. */
+            u64 allocated_objects;
+            /** Number of bytes allocated since the thread was started. */
+            u64 allocated_bytes;
+            /**
+             * Allocation rate in bytes per second, measured between the two
+             * most recent collections.
+             */
+            u64 allocation_rate;
+            /** Number of memory blocks which are in use. */
+            std::size_t blocks;
+            /** Number of empty memory blocks kept around for reuse. */
+            std::size_t spare_blocks;
+            /** Number of objects currently allocated. */
+            std::size_t live_objects;
+            /** Bytes used by currently allocated objects. */
+            std::size_t live_bytes;
+            /**
+             * Bytes in used memory blocks which are not occupied by objects,
+             * including the block headers.
+             */
+            std::size_t free_bytes;
+            /** Number of objects in the large object space. */
+            std::size_t large_objects;
+            /** Bytes used by objects in the large object space. */
+            std::size_t large_bytes;
+            /** Current collection thresholds of each generation. */
+            int thresholds[3];
+        };
+
+        /**
+         * Statistics of single memory block of the small object space.
+         */
+        struct BlockStatistics
+        {
+            /** Size of objects allocated from the block. */
+            std::size_t object_size;
+            /** Number of objects currently allocated from the block. */
+            std::size_t live_objects;
+            /** Bytes used by currently allocated objects. */
+            std::size_t live_bytes;
+            /**
+             * Bytes in the block which are not occupied by objects, including
+             * the block header.
+             */
+            std::size_t free_bytes;
+            /** Whether the block belongs to a request arena. */
+            bool arena;
+        };
+
+        /**
+         * Returns collector options used by threads which have not been
+         * configured otherwise. These are the compile time defaults,
+         * overridden by environment variables <code>TEMPEARLY_GC_THRESHOLD0</code>,
+         * <code>TEMPEARLY_GC_THRESHOLD1</code>, <code>TEMPEARLY_GC_THRESHOLD2</code>,
+         * <code>TEMPEARLY_GC_ADAPTIVE</code>, <code>TEMPEARLY_GC_PROFILE</code>
+         * and <code>TEMPEARLY_GC_SWEEP_BUDGET</code>, unless
+         * <code>SetOptions</code> has been called.
+         */
+        static Options GetOptions();
+
+        /**
+         * Sets collector options of current thread and of threads which start
+         * using the heap afterwards. Meant to be called by the SAPI during
+         * startup, before any other threads have been started.
+         */
+        static void SetOptions(const Options& options);
+
+        /**
+         * Returns statistics of the heap of current thread.
+         */
+        static Statistics GetStatistics();
+
+        /**
+         * Appends statistics of each memory block in use by current thread
+         * into given vector. Blocks of the large object space are not
+         * included.
+         */
+        static void GetBlockStatistics(Vector<BlockStatistics>& slot);
+
+        /**
+         * Returns true if allocations made by current thread are being
+         * profiled.
+         */
+        static bool IsProfiling();
+
+        /**
+         * Sets line number of the script statement which is being executed,
+         * so that subsequent allocations can be attributed to it when
+         * profiling.
+         */
+        static void SetAllocationSite(int line);
+
+        /**
+         * Returns allocation profile collected since the previous call as
+         * single line of JSON and resets it. Objects and bytes are counted
+         * for each class and for each source code line. Returns empty string
+         * if profiling is not enabled.
+         */
+        static String GetProfile();
+
+        /**
+         * Performs garbage collection if enough objects have been allocated
+         * since the previous one. Collection is never performed during
+         * allocation because objects which are still being constructed cannot
+         * be examined. Instead this has to be called from points where every
+         * object which is in use can be reached through a handle.
+         */
+        static void Safepoint();
+
+    private:
+        TEMPEARLY_DISALLOW_IMPLICIT_CONSTRUCTORS(Heap);
+    };
+
+    /**
+     * Scoped allocation arena, meant to be used for the duration of a single
+     * request. While an arena exists, garbage collected objects are allocated
+     * from separate blocks and are not examined by the generational garbage
+     * collector. When the outermost arena is destroyed, objects which are
+     * still reachable (such as cached scripts) are promoted into the oldest
+     * generation and everything else is destroyed at once.
+     *
+     * Handles to objects allocated from the arena should be released before
+     * the arena is destroyed, otherwise the objects are kept alive.
+     */
+    class Arena
+    {
+    public:
+        explicit Arena();
+
+        ~Arena();
+
+    private:
+        TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Arena);
+    };
 }
 
 #endif /* !TEMPEARLY_MEMORY_H_GUARD */
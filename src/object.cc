@@ -19,8 +19,33 @@ namespace tempearly
 
     bool Object::GetAttribute(const Handle<Interpreter>& interpreter,
                               const String& name,
-                              Handle<Object>& slot)
+                              Handle<Object>& slot,
+                              AttributeCache* cache)
     {
+        bool from_class;
+
+        if (!FindAttribute(interpreter, name, slot, from_class, cache))
+        {
+            return false;
+        }
+        else if (from_class && slot->IsUnboundMethod())
+        {
+            slot = slot.As<FunctionObject>()->Curry(
+                interpreter,
+                Vector<Handle<Object>>(1, this)
+            );
+        }
+
+        return true;
+    }
+
+    bool Object::FindAttribute(const Handle<Interpreter>& interpreter,
+                               const String& name,
+                               Handle<Object>& slot,
+                               bool& from_class,
+                               AttributeCache* cache)
+    {
+        from_class = false;
         if (GetOwnAttribute(name, slot))
         {
             return true;
@@ -32,26 +57,24 @@ namespace tempearly
         {
             if (cls->GetOwnAttribute(name, slot))
             {
-                if (slot->IsUnboundMethod())
-                {
-                    slot = slot.As<FunctionObject>()->Curry(
-                        interpreter,
-                        Vector<Handle<Object>>(1, this)
-                    );
-                }
+                from_class = true;
 
                 return true;
             }
         }
+        else if (cache && cache->Find(cls, slot))
+        {
+            from_class = true;
+
+            return true;
+        }
         else if (cls->GetAttribute(interpreter, name, slot))
         {
-            if (slot->IsUnboundMethod())
+            if (cache)
             {
-                slot = slot.As<FunctionObject>()->Curry(
-                    interpreter,
-                    Vector<Handle<Object>>(1, this)
-                );
+                cache->Insert(cls, slot);
             }
+            from_class = true;
 
             return true;
         }
@@ -77,11 +100,15 @@ namespace tempearly
     bool Object::CallMethod(const Handle<Interpreter>& interpreter,
                             Handle<Object>& slot,
                             const String& method_name,
-                            const Vector<Handle<Object>>& args)
+                            const Vector<Handle<Object>>& args,
+                            AttributeCache* cache)
     {
         Handle<Object> function;
+        bool from_class;
 
-        if (GetAttribute(interpreter, method_name, function))
+        // Methods are invoked with the receiver prepended to the arguments
+        // directly, instead of binding them to the receiver first.
+        if (FindAttribute(interpreter, method_name, function, from_class, cache))
         {
             if (function->IsUnboundMethod())
             {
@@ -142,8 +169,9 @@ namespace tempearly
                             const Vector<Handle<Object>>& args)
     {
         Handle<Object> function;
+        bool from_class;
 
-        if (GetAttribute(interpreter, method_name, function))
+        if (FindAttribute(interpreter, method_name, function, from_class))
         {
             if (function->IsUnboundMethod())
             {
@@ -198,9 +226,14 @@ namespace tempearly
                         const Handle<Object>& that,
                         bool& slot)
     {
+        static thread_local const String name = String("__eq__").Intern();
         Handle<Object> result;
 
-        if (!CallMethod(interpreter, result, "__eq__", that))
+        if (NativeEquals(that, slot) && !GetClass(interpreter)->HasCustomEquality())
+        {
+            return true;
+        }
+        else if (!CallMethod(interpreter, result, name, that))
         {
             return false;
         }
@@ -213,9 +246,10 @@ namespace tempearly
                             const Handle<Object>& that,
                             bool& slot)
     {
+        static thread_local const String name = String("__lt__").Intern();
         Handle<Object> result;
 
-        if (!CallMethod(interpreter, result, "__lt__", that))
+        if (!CallMethod(interpreter, result, name, that))
         {
             return false;
         }
@@ -227,7 +261,9 @@ namespace tempearly
     bool Object::GetNext(const Handle<Interpreter>& interpreter,
                          Handle<Object>& slot)
     {
-        if (CallMethod(interpreter, slot, "next"))
+        static thread_local const String name = String("next").Intern();
+
+        if (CallMethod(interpreter, slot, name))
         {
             return true;
         }
@@ -241,9 +277,14 @@ namespace tempearly
 
     bool Object::GetHash(const Handle<Interpreter>& interpreter, i64& slot)
     {
+        static thread_local const String name = String("__hash__").Intern();
         Handle<Object> result;
 
-        if (CallMethod(interpreter, result, "__hash__"))
+        if (GetNativeHash(slot) && !GetClass(interpreter)->HasCustomEquality())
+        {
+            return true;
+        }
+        else if (CallMethod(interpreter, result, name))
         {
             if (result->IsInt())
             {
@@ -262,6 +303,16 @@ namespace tempearly
         return false;
     }
 
+    bool Object::GetNativeHash(i64&) const
+    {
+        return false;
+    }
+
+    bool Object::NativeEquals(const Handle<Object>&, bool&) const
+    {
+        return false;
+    }
+
     ByteString Object::AsBinary() const
     {
         return ByteString();
@@ -392,9 +443,10 @@ namespace tempearly
         {
             slot = false;
         } else {
+            static thread_local const String name = String("__bool__").Intern();
             Handle<Object> result;
 
-            if (!CallMethod(interpreter, result, "__bool__"))
+            if (!CallMethod(interpreter, result, name))
             {
                 return false;
             }
@@ -424,9 +476,10 @@ namespace tempearly
         {
             slot.Clear();
         } else {
+            static thread_local const String name = String("__str__").Intern();
             Handle<Object> result;
 
-            if (!CallMethod(interpreter, result, "__str__"))
+            if (!CallMethod(interpreter, result, name))
             {
                 return false;
             }
@@ -487,6 +540,20 @@ namespace tempearly
                 return true;
             }
 
+            bool GetNativeHash(i64& slot) const
+            {
+                slot = static_cast<i64>(reinterpret_cast<u64>(this));
+
+                return true;
+            }
+
+            bool NativeEquals(const Handle<Object>& that, bool& slot) const
+            {
+                slot = that->IsNull();
+
+                return true;
+            }
+
         private:
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(NullObject);
         };
@@ -512,6 +579,20 @@ namespace tempearly
                 return m_value;
             }
 
+            bool GetNativeHash(i64& slot) const
+            {
+                slot = m_value ? 1231 : 1237;
+
+                return true;
+            }
+
+            bool NativeEquals(const Handle<Object>& that, bool& slot) const
+            {
+                slot = that->IsBool() && that->AsBool() == m_value;
+
+                return true;
+            }
+
         private:
             const bool m_value;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(BoolObject);
@@ -543,6 +624,25 @@ namespace tempearly
                 return true;
             }
 
+            bool GetNativeHash(i64& slot) const
+            {
+                slot = m_value;
+
+                return true;
+            }
+
+            bool NativeEquals(const Handle<Object>& that, bool& slot) const
+            {
+                if (that->IsInt())
+                {
+                    slot = m_value == that->AsInt();
+                } else {
+                    slot = that->IsFloat() && static_cast<double>(m_value) == that->AsFloat();
+                }
+
+                return true;
+            }
+
         private:
             const i64 m_value;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(IntObject);
@@ -585,6 +685,35 @@ namespace tempearly
                 return true;
             }
 
+            bool GetNativeHash(i64& slot) const
+            {
+                i64 i;
+
+                if (std::isnan(m_value))
+                {
+                    i = 0x7ff8000000000000LL;
+                } else {
+                    union
+                    {
+                        i64 i;
+                        double f;
+                    } shaker;
+
+                    shaker.f = m_value;
+                    i = shaker.i;
+                }
+                slot = i ^ (static_cast<u64>(i >> 32));
+
+                return true;
+            }
+
+            bool NativeEquals(const Handle<Object>& that, bool& slot) const
+            {
+                slot = (that->IsFloat() || that->IsInt()) && m_value == that->AsFloat();
+
+                return true;
+            }
+
         private:
             const double m_value;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(FloatObject);
@@ -611,6 +740,20 @@ namespace tempearly
                 return m_value;
             }
 
+            bool GetNativeHash(i64& slot) const
+            {
+                slot = m_value.HashCode();
+
+                return true;
+            }
+
+            bool NativeEquals(const Handle<Object>& that, bool& slot) const
+            {
+                slot = that->IsString() && m_value.Equals(that->AsString());
+
+                return true;
+            }
+
         private:
             const String m_value;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(StringObject);
@@ -637,15 +780,48 @@ namespace tempearly
                 return m_value;
             }
 
+            bool GetNativeHash(i64& slot) const
+            {
+                i64 hash = 0;
+
+                for (std::size_t i = 0; i < m_value.GetLength(); ++i)
+                {
+                    hash += m_value[i];
+                    hash += (hash << 10);
+                    hash ^= (hash >> 6);
+                }
+                hash += (hash << 3);
+                hash ^= (hash >> 11);
+                hash += (hash << 15);
+                slot = hash;
+
+                return true;
+            }
+
+            bool NativeEquals(const Handle<Object>& that, bool& slot) const
+            {
+                slot = that->IsBinary() && m_value.Equals(that->AsBinary());
+
+                return true;
+            }
+
         private:
             const ByteString m_value;
             TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(BinaryObject);
         };
     }
 
+    // Shared instances are created separately for each thread, since they are
+    // allocated from the heap of the thread which uses them.
+
+    /** Smallest integer whose object is shared between all uses. */
+    static const i64 kIntCacheMin = -128;
+    /** Largest integer whose object is shared between all uses. */
+    static const i64 kIntCacheMax = 1023;
+
     Handle<Object> Object::NewNull()
     {
-        static Handle<Object> instance;
+        static thread_local Handle<Object> instance;
 
         if (!instance)
         {
@@ -657,8 +833,8 @@ namespace tempearly
 
     Handle<Object> Object::NewBool(bool value)
     {
-        static Handle<Object> true_instance;
-        static Handle<Object> false_instance;
+        static thread_local Handle<Object> true_instance;
+        static thread_local Handle<Object> false_instance;
 
         if (value)
         {
@@ -679,7 +855,36 @@ namespace tempearly
 
     Handle<Object> Object::NewInt(i64 value)
     {
-        return new IntObject(value);
+        static thread_local Object** cache = nullptr;
+        Object** slot;
+
+        if (value < kIntCacheMin || value > kIntCacheMax)
+        {
+            return new IntObject(value);
+        }
+        if (!cache)
+        {
+            const std::size_t size = static_cast<std::size_t>(kIntCacheMax - kIntCacheMin + 1);
+
+            if (!(cache = Memory::Allocate<Object*>(size)))
+            {
+                throw std::bad_alloc();
+            }
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                cache[i] = nullptr;
+            }
+        }
+        slot = cache + (value - kIntCacheMin);
+        if (!*slot)
+        {
+            // Cached instances are never released, so they hold a reference
+            // to themselves instead of being kept in handles.
+            *slot = new IntObject(value);
+            (*slot)->IncReferenceCount();
+        }
+
+        return *slot;
     }
 
     Handle<Object> Object::NewFloat(double value)
@@ -24,7 +24,8 @@ namespace tempearly
         static Handle<Object> NewBool(bool value);
 
         /**
-         * Constructs integer object.
+         * Constructs integer object. Objects of small integers are shared,
+         * so that counters and loop indexes do not allocate memory.
          */
         static Handle<Object> NewInt(i64 value);
 
@@ -55,10 +56,24 @@ namespace tempearly
             const Handle<Class>& cls
         ) const;
 
+        /**
+         * Retrieves attribute of the object, either from the object itself
+         * or from it's class. Methods retrieved from the class are bound to
+         * the object.
+         *
+         * \param interpreter Script interpreter
+         * \param name        Name of the attribute
+         * \param slot        Where value of the attribute is assigned to
+         * \param cache       Optional inline cache which is used for looking
+         *                    up the attribute from the class
+         * \return            A boolean flag indicating whether the attribute
+         *                    was found or whether an exception was thrown
+         */
         bool GetAttribute(
             const Handle<Interpreter>& interpreter,
             const String& name,
-            Handle<Object>& slot
+            Handle<Object>& slot,
+            AttributeCache* cache = nullptr
         );
 
         /**
@@ -80,7 +95,8 @@ namespace tempearly
             const Handle<Interpreter>& interpreter,
             Handle<Object>& slot,
             const String& method_name,
-            const Vector<Handle<Object>>& args = Vector<Handle<Object>>()
+            const Vector<Handle<Object>>& args = Vector<Handle<Object>>(),
+            AttributeCache* cache = nullptr
         );
 
         bool CallMethod(
@@ -104,7 +120,9 @@ namespace tempearly
 
         /**
          * Performs equality test between two object. This is done by invoking
-         * the "__eq__" method with given object as argument.
+         * the "__eq__" method with given object as argument, unless this
+         * object is a value of builtin type whose class has not replaced
+         * that method, in which case the objects are compared natively.
          *
          * \param interpreter Script interpreter
          * \param that        Other object to test equality with
@@ -154,7 +172,9 @@ namespace tempearly
         /**
          * Attempts to generate hash code for the object. This is done by
          * invoking method "__hash__" and converting it's result into
-         * integer.
+         * integer, unless this object is a value of builtin type whose class
+         * has not replaced that method, in which case the hash code is
+         * generated natively.
          *
          * \param interpreter Script interpreter
          * \param slot        Where the resulting hash code is assigned to
@@ -167,6 +187,20 @@ namespace tempearly
             i64& slot
         );
 
+        /**
+         * Generates hash code for values of builtin types, such as integers
+         * and strings, without invoking any methods. Returns false if the
+         * object has no native hash code.
+         */
+        virtual bool GetNativeHash(i64& slot) const;
+
+        /**
+         * Tests equality of builtin type value with another object without
+         * invoking any methods. Returns false if the object has no native
+         * equality test.
+         */
+        virtual bool NativeEquals(const Handle<Object>& that, bool& slot) const;
+
         virtual ByteString AsBinary() const;
 
         bool AsBinary(
@@ -278,6 +312,28 @@ namespace tempearly
         }
 
     private:
+        /**
+         * Looks up attribute of the object without binding methods retrieved
+         * from the class to the object.
+         *
+         * \param interpreter Script interpreter
+         * \param name        Name of the attribute
+         * \param slot        Where value of the attribute is assigned to
+         * \param from_class  Where a flag indicating whether the attribute
+         *                    was retrieved from the class is assigned to
+         * \param cache       Optional inline cache which is used for looking
+         *                    up the attribute from the class
+         * \return            A boolean flag indicating whether the attribute
+         *                    was found or whether an exception was thrown
+         */
+        bool FindAttribute(
+            const Handle<Interpreter>& interpreter,
+            const String& name,
+            Handle<Object>& slot,
+            bool& from_class,
+            AttributeCache* cache = nullptr
+        );
+
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Object);
     };
 }
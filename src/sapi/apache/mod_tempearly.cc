@@ -33,6 +33,7 @@ extern "C" int tempearly_handler(request_rec* request)
         return HTTP_FORBIDDEN;
     }
 
+    const Arena arena;
     Handle<Interpreter> interpreter = new Interpreter(
         new ApacheRequest(request),
         new ApacheResponse(request)
@@ -43,6 +44,10 @@ extern "C" int tempearly_handler(request_rec* request)
     if (!interpreter->Include(Filename(request->filename)))
     {
         interpreter->GetResponse()->SendException(interpreter->GetException());
+        if (Heap::IsProfiling())
+        {
+            std::fprintf(stderr, "%s\n", Heap::GetProfile().Encode().c_str());
+        }
 
         return HTTP_INTERNAL_SERVER_ERROR;
     }
@@ -50,6 +55,10 @@ extern "C" int tempearly_handler(request_rec* request)
     {
         interpreter->GetResponse()->Commit();
     }
+    if (Heap::IsProfiling())
+    {
+        std::fprintf(stderr, "%s\n", Heap::GetProfile().Encode().c_str());
+    }
 
     return OK;
 }
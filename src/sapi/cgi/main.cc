@@ -23,6 +23,10 @@ int main(int argc, char** argv)
         {
             interpreter->GetResponse()->Commit();
         }
+        if (Heap::IsProfiling())
+        {
+            std::fprintf(stderr, "%s\n", Heap::GetProfile().Encode().c_str());
+        }
     }
 
     return EXIT_SUCCESS;
@@ -20,6 +20,9 @@ int main(int argc, char** argv)
 
         while (FCGI_Accept() >= 0)
         {
+            // Everything allocated during the request is released at once
+            // after the interpreter goes out of scope.
+            const Arena arena;
             const Handle<Interpreter> interpreter = new Interpreter(
                 new CgiRequest(),
                 new CgiResponse()
@@ -42,6 +45,10 @@ int main(int argc, char** argv)
                 interpreter->GetResponse()->SendException(interpreter->GetException());
             }
             interpreter->PopFrame();
+            if (Heap::IsProfiling())
+            {
+                fprintf(stderr, "%s\n", Heap::GetProfile().Encode().c_str());
+            }
         }
     }
 
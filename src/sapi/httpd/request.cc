@@ -7,27 +7,14 @@ namespace tempearly
                                          const String& path,
                                          const ByteString& query_string,
                                          const Dictionary<String>& headers,
-                                         const byte* body,
-                                         std::size_t body_size)
+                                         const ByteString& body)
         : m_method(method)
         , m_path(path)
         , m_query_string(query_string)
         , m_headers(headers)
-        , m_body(nullptr)
-    {
-        if (body_size)
-        {
-            m_body = new ByteString(body, body_size);
-        }
-    }
+        , m_body(body) {}
 
-    HttpServerRequest::~HttpServerRequest()
-    {
-        if (m_body)
-        {
-            delete m_body;
-        }
-    }
+    HttpServerRequest::~HttpServerRequest() {}
 
     HttpMethod::Kind HttpServerRequest::GetMethod() const
     {
@@ -84,7 +71,7 @@ namespace tempearly
 
     ByteString HttpServerRequest::GetBody()
     {
-        return m_body ? *m_body : ByteString();
+        return m_body;
     }
 
     ByteString HttpServerRequest::GetQueryString()
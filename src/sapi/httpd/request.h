@@ -12,8 +12,7 @@ namespace tempearly
                                    const String& path,
                                    const ByteString& query_string,
                                    const Dictionary<String>& headers,
-                                   const byte* body,
-                                   std::size_t body_size);
+                                   const ByteString& body);
 
         ~HttpServerRequest();
 
@@ -42,7 +41,7 @@ namespace tempearly
         const String m_path;
         const ByteString m_query_string;
         const Dictionary<String> m_headers;
-        ByteString* m_body;
+        const ByteString m_body;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(HttpServerRequest);
     };
 }
@@ -38,7 +38,7 @@ namespace tempearly
 
     static Dictionary<String> mime_type_map;
 
-    static byte* parse_request(HttpServer::HttpRequest&, const Handle<Socket>&, byte*, std::size_t&);
+    static bool parse_request(HttpServer::HttpRequest&, const Handle<Socket>&, const ByteString&);
     static void send_error(const Handle<Socket>&, const char*, const String&);
     static void compile_script(HttpServer::ScriptMapping&);
     static String get_mime_type(const String&);
@@ -49,7 +49,9 @@ namespace tempearly
 
     HttpServer::~HttpServer()
     {
-        if (m_socket)
+        // The socket might already have been destroyed by the garbage
+        // collector if both are being finalized at the same time.
+        if (m_socket && !m_socket->HasFlag(CountedObject::FLAG_FINALIZING))
         {
             m_socket->Close();
         }
@@ -82,7 +84,6 @@ namespace tempearly
         HttpRequest request;
         byte buffer[HTTPD_MAX_REQUEST_SIZE];
         std::size_t buffer_size;
-        byte* data;
         Filename path;
 
         if (!client->Read(buffer, HTTPD_MAX_REQUEST_SIZE, buffer_size))
@@ -91,7 +92,9 @@ namespace tempearly
             return;
         }
 
-        if (!(data = parse_request(request, client, buffer, buffer_size)))
+        // Query string and body of the request are handed out as slices of
+        // the raw request, which is copied from the buffer only once.
+        if (!parse_request(request, client, ByteString(buffer, buffer_size)))
         {
             return;
         }
@@ -121,7 +124,7 @@ namespace tempearly
 
             if (index.Exists() && !index.IsDir())
             {
-                ServeScript(client, request, index, data, buffer_size);
+                ServeScript(client, request, index);
             }
             else if ((index = path + "index.html").Exists() && !index.IsDir())
             {
@@ -140,7 +143,7 @@ namespace tempearly
 
             if (extension == "tly")
             {
-                ServeScript(client, request, path, data, buffer_size);
+                ServeScript(client, request, path);
             } else {
                 ServeFile(client, request, path, get_mime_type(extension));
             }
@@ -177,10 +180,11 @@ namespace tempearly
 
     void HttpServer::ServeScript(const Handle<Socket>& client,
                                  const HttpRequest& request,
-                                 const Filename& path,
-                                 const byte* data,
-                                 std::size_t data_size)
+                                 const Filename& path)
     {
+        // Compiled scripts survive the arena through the script cache,
+        // everything else allocated by the request is released at once.
+        const Arena arena;
         String full_name = path.GetFullName();
         Dictionary<ScriptMapping>::Entry* entry = m_script_cache.Find(full_name);
         Handle<Interpreter> interpreter;
@@ -206,8 +210,7 @@ namespace tempearly
                 request.path,
                 request.query_string,
                 request.headers,
-                data,
-                data_size
+                request.body
             ),
             new HttpServerResponse(client)
         );
@@ -231,6 +234,10 @@ namespace tempearly
         }
         interpreter->PopFrame();
         client->Close();
+        if (Heap::IsProfiling())
+        {
+            std::fprintf(stderr, "%s\n", Heap::GetProfile().Encode().c_str());
+        }
     }
 
     void HttpServer::Mark()
@@ -246,7 +253,8 @@ namespace tempearly
         {
             Script* script = entry->GetValue().script;
 
-            if (!script->IsMarked())
+            // Scripts which failed to compile are cached as well.
+            if (script && !script->IsMarked())
             {
                 script->Mark();
             }
@@ -255,6 +263,7 @@ namespace tempearly
 
     static bool parse_request_uri(HttpServer::HttpRequest& request,
                                   const Handle<Socket>& client,
+                                  const ByteString& input,
                                   const byte* start,
                                   std::size_t remain)
     {
@@ -263,7 +272,10 @@ namespace tempearly
 
         if (end)
         {
-            request.query_string = ByteString(end + 1, remain - (end - begin));
+            request.query_string = input.SubString(
+                end + 1 - input.GetBytes(),
+                remain - (end - begin + 1)
+            );
             remain = end - begin;
         }
         if (!Url::Decode(begin, remain, request.path))
@@ -278,6 +290,7 @@ namespace tempearly
 
     static bool parse_request_line(HttpServer::HttpRequest& request,
                                    const Handle<Socket>& client,
+                                   const ByteString& input,
                                    const byte* start,
                                    std::size_t remain)
     {
@@ -296,7 +309,7 @@ namespace tempearly
         {
             const String version = String::DecodeAscii(end + 1, remain - (end - begin + 1));
 
-            if (!parse_request_uri(request, client, begin, end - begin))
+            if (!parse_request_uri(request, client, input, begin, end - begin))
             {
                 return false;
             }
@@ -309,7 +322,7 @@ namespace tempearly
         } else {
             request.version = HttpVersion::VERSION_09;
 
-            return parse_request_uri(request, client, begin, remain);
+            return parse_request_uri(request, client, input, begin, remain);
         }
 
         return true;
@@ -342,19 +355,20 @@ namespace tempearly
         return true;
     }
 
-    static byte* parse_request(HttpServer::HttpRequest& request,
-                               const Handle<Socket>& client,
-                               byte* start,
-                               std::size_t& remain)
+    static bool parse_request(HttpServer::HttpRequest& request,
+                              const Handle<Socket>& client,
+                              const ByteString& input)
     {
-        byte* begin = start;
-        byte* end = static_cast<byte*>(std::memchr(begin, '\n', remain));
+        const byte* start = input.GetBytes();
+        std::size_t remain = input.GetLength();
+        const byte* begin = start;
+        const byte* end = static_cast<const byte*>(std::memchr(begin, '\n', remain));
 
         if (!end)
         {
             send_error(client, "400 Bad Request", "We were unable to process your request.");
 
-            return 0;
+            return false;
         }
 
         // Find out where the first line of the request ends.
@@ -366,18 +380,18 @@ namespace tempearly
         }
 
         // Process first line of the request.
-        if (!parse_request_line(request, client, begin, end - begin))
+        if (!parse_request_line(request, client, input, begin, end - begin))
         {
-            return 0;
+            return false;
         }
 
         // Process request headers
         for (;;)
         {
             begin = start;
-            if (!(end = static_cast<byte*>(std::memchr(begin, '\n', remain))))
+            if (!(end = static_cast<const byte*>(std::memchr(begin, '\n', remain))))
             {
-                return 0;
+                return false;
             }
             remain -= end - begin + 1;
             start = end + 1;
@@ -387,11 +401,13 @@ namespace tempearly
             }
             if (end <= begin)
             {
-                return start;
+                request.body = input.SubString(start - input.GetBytes());
+
+                return true;
             }
             else if (!parse_request_header(request, client, begin, end - begin))
             {
-                return nullptr;
+                return false;
             }
         }
     }
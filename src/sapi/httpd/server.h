@@ -23,6 +23,8 @@ namespace tempearly
             ByteString query_string;
             HttpVersion::Kind version;
             Dictionary<String> headers;
+            /** Body of the request, sharing data with the raw request. */
+            ByteString body;
         };
 
         /**
@@ -82,9 +84,7 @@ namespace tempearly
 
         void ServeScript(const Handle<Socket>& client,
                          const HttpRequest& request,
-                         const Filename& path,
-                         const byte* data,
-                         std::size_t size);
+                         const Filename& path);
 
     private:
         const Filename m_root;
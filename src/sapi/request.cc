@@ -90,7 +90,7 @@ namespace tempearly
         m_parameters_parsed = true;
         if (!query_string.IsEmpty())
         {
-            Utils::ParseQueryString(query_string.GetBytes(), query_string.GetLength(), m_parameters);
+            Utils::ParseQueryString(query_string, m_parameters);
         }
         // TODO: process multipart requests
         if (GetMethod() == HttpMethod::POST
@@ -99,7 +99,7 @@ namespace tempearly
         {
             const ByteString body = GetBody();
 
-            Utils::ParseQueryString(body.GetBytes(), body.GetLength(), m_parameters);
+            Utils::ParseQueryString(body, m_parameters);
         }
     }
 }
@@ -7,7 +7,8 @@
 
 namespace tempearly
 {
-    Node::Node() {}
+    Node::Node()
+        : m_line(0) {}
 
     bool Node::Evaluate(const Handle<Interpreter>& interpreter,
                         Handle<Object>& slot) const
@@ -119,7 +120,7 @@ namespace tempearly
     {
         for (std::size_t i = 0; i < m_nodes.GetSize(); ++i)
         {
-            const Result result = m_nodes[i]->Execute(interpreter);
+            const Result result = m_nodes[i]->ExecuteStatement(interpreter);
 
             if (!result.Is(Result::KIND_SUCCESS))
             {
@@ -163,11 +164,11 @@ namespace tempearly
         }
         else if (b)
         {
-            return m_then_statement->Execute(interpreter);
+            return m_then_statement->ExecuteStatement(interpreter);
         }
         else if (m_else_statement)
         {
-            return m_else_statement->Execute(interpreter);
+            return m_else_statement->ExecuteStatement(interpreter);
         } else {
             return Result();
         }
@@ -207,7 +208,12 @@ namespace tempearly
         }
         while (b)
         {
-            const Result result = m_statement->Execute(interpreter);
+            // Every iteration is a safepoint of the garbage collector, so
+            // that loops which allocate without calling any functions still
+            // get their garbage collected.
+            Heap::Safepoint();
+
+            const Result result = m_statement->ExecuteStatement(interpreter);
 
             switch (result.GetKind())
             {
@@ -270,9 +276,10 @@ namespace tempearly
         {
             do
             {
+                Heap::Safepoint();
                 if (m_variable->AssignLocal(interpreter, element))
                 {
-                    const Result result = m_statement->Execute(interpreter);
+                    const Result result = m_statement->ExecuteStatement(interpreter);
 
                     switch (result.GetKind())
                     {
@@ -304,7 +311,7 @@ namespace tempearly
         }
         else if (m_else_statement)
         {
-            return m_else_statement->Execute(interpreter);
+            return m_else_statement->ExecuteStatement(interpreter);
         } else {
             return Result();
         }
@@ -354,7 +361,7 @@ namespace tempearly
         {
             return Result(Result::KIND_ERROR);
         } else {
-            return m_statement->Execute(interpreter);
+            return m_statement->ExecuteStatement(interpreter);
         }
     }
 
@@ -386,7 +393,7 @@ namespace tempearly
 
     Result TryNode::Execute(const Handle<Interpreter>& interpreter) const
     {
-        Result result = m_statement->Execute(interpreter);
+        Result result = m_statement->ExecuteStatement(interpreter);
 
         if (result.Is(Result::KIND_ERROR))
         {
@@ -413,11 +420,11 @@ namespace tempearly
         }
         else if (m_else_statement)
         {
-            result = m_else_statement->Execute(interpreter);
+            result = m_else_statement->ExecuteStatement(interpreter);
         }
         if (m_finally_statement)
         {
-            Result finally_result = m_finally_statement->Execute(interpreter);
+            Result finally_result = m_finally_statement->ExecuteStatement(interpreter);
 
             if (finally_result.Is(Result::KIND_ERROR))
             {
@@ -660,7 +667,7 @@ namespace tempearly
                                  const String& id,
                                  bool null_safe)
         : m_receiver(receiver.Get())
-        , m_id(id)
+        , m_id(id.Intern())
         , m_null_safe(null_safe) {}
 
     bool AttributeNode::IsVariable() const
@@ -680,7 +687,7 @@ namespace tempearly
         {
             return Result();
         }
-        else if (value->GetAttribute(interpreter, m_id, value))
+        else if (value->GetAttribute(interpreter, m_id, value, &m_cache))
         {
             return value;
         } else {
@@ -712,6 +719,7 @@ namespace tempearly
         {
             m_receiver->Mark();
         }
+        m_cache.Mark();
     }
 
     CallNode::CallNode(const Handle<Node>& receiver,
@@ -719,7 +727,7 @@ namespace tempearly
                        const Vector<Handle<Node> >& args,
                        bool null_safe)
         : m_receiver(receiver.Get())
-        , m_id(id)
+        , m_id(id.Intern())
         , m_args(args)
         , m_null_safe(null_safe) {}
 
@@ -748,7 +756,7 @@ namespace tempearly
                 }
                 args.PushBack(argument);
             }
-            if (value->CallMethod(interpreter, value, m_id, args))
+            if (value->CallMethod(interpreter, value, m_id, args, &m_cache))
             {
                 return value;
             } else {
@@ -771,6 +779,7 @@ namespace tempearly
                 m_args[i]->Mark();
             }
         }
+        m_cache.Mark();
     }
 
     PrefixNode::PrefixNode(const Handle<Node>& variable, Kind kind)
@@ -779,13 +788,15 @@ namespace tempearly
 
     Result PrefixNode::Execute(const Handle<Interpreter>& interpreter) const
     {
+        static thread_local const String inc_name = String("__inc__").Intern();
+        static thread_local const String dec_name = String("__dec__").Intern();
         Handle<Object> value;
 
         if (!m_variable->Evaluate(interpreter, value))
         {
             return Result(Result::KIND_ERROR);
         }
-        if (!value->CallMethod(interpreter, value, m_kind == INCREMENT ? "__inc__" : "__dec__")
+        if (!value->CallMethod(interpreter, value, m_kind == INCREMENT ? inc_name : dec_name)
             || !m_variable->Assign(interpreter, value))
         {
             return Result(Result::KIND_ERROR);
@@ -809,6 +820,8 @@ namespace tempearly
 
     Result PostfixNode::Execute(const Handle<Interpreter>& interpreter) const
     {
+        static thread_local const String inc_name = String("__inc__").Intern();
+        static thread_local const String dec_name = String("__dec__").Intern();
         Handle<Object> value;
         Handle<Object> result;
 
@@ -816,7 +829,7 @@ namespace tempearly
         {
             return Result(Result::KIND_ERROR);
         }
-        if (!value->CallMethod(interpreter, result, m_kind == INCREMENT ? "__inc__" : "__dec__")
+        if (!value->CallMethod(interpreter, result, m_kind == INCREMENT ? inc_name : dec_name)
             || !m_variable->Assign(interpreter, result))
         {
             return Result(Result::KIND_ERROR);
@@ -846,13 +859,14 @@ namespace tempearly
 
     Result SubscriptNode::Execute(const Handle<Interpreter>& interpreter) const
     {
+        static thread_local const String name = String("__getitem__").Intern();
         Handle<Object> container;
         Handle<Object> index;
         Handle<Object> result;
 
         if (!m_container->Evaluate(interpreter, container)
             || !m_index->Evaluate(interpreter, index)
-            || !container->CallMethod(interpreter, result, "__getitem__", index))
+            || !container->CallMethod(interpreter, result, name, index))
         {
             return Result(Result::KIND_ERROR);
         } else {
@@ -863,6 +877,7 @@ namespace tempearly
     bool SubscriptNode::Assign(const Handle<Interpreter>& interpreter,
                                const Handle<Object>& value) const
     {
+        static thread_local const String name = String("__setitem__").Intern();
         Handle<Object> container;
         Handle<Object> index;
         Vector<Handle<Object>> args;
@@ -876,7 +891,7 @@ namespace tempearly
         args.PushBack(index);
         args.PushBack(value);
 
-        return container->CallMethod(interpreter, "__setitem__", args);
+        return container->CallMethod(interpreter, name, args);
     }
 
     void SubscriptNode::Mark()
@@ -924,7 +939,7 @@ namespace tempearly
     }
 
     IdentifierNode::IdentifierNode(const String& id)
-        : m_id(id) {}
+        : m_id(id.Intern()) {}
 
     bool IdentifierNode::IsVariable() const
     {
@@ -1093,11 +1108,11 @@ namespace tempearly
 
             if (!entry.GetKey()->Evaluate(interpreter, key)
                 || !entry.GetValue()->Evaluate(interpreter, value)
-                || !key->GetHash(interpreter, hash))
+                || !key->GetHash(interpreter, hash)
+                || !map->Insert(interpreter, hash, key, value))
             {
                 return Result(Result::KIND_ERROR);
             }
-            map->Insert(hash, key, value);
         }
 
         return Result(Result::KIND_SUCCESS, map);
@@ -1,6 +1,7 @@
 #ifndef TEMPEARLY_SCRIPT_NODE_H_GUARD
 #define TEMPEARLY_SCRIPT_NODE_H_GUARD
 
+#include "api/class.h"
 #include "core/pair.h"
 #include "script/result.h"
 
@@ -68,7 +69,40 @@ namespace tempearly
          virtual bool AssignLocal(const Handle<Interpreter>& interpreter,
                                   const Handle<Object>& value) const;
 
+        /**
+         * Returns line number of the statement in source code, or zero if
+         * the node is not a statement.
+         */
+        inline int GetLine() const
+        {
+            return m_line;
+        }
+
+        /**
+         * Sets line number of the statement in source code.
+         */
+        inline void SetLine(int line)
+        {
+            m_line = line;
+        }
+
+        /**
+         * Executes node as statement, after marking it as the allocation
+         * site of objects allocated during the execution.
+         */
+        inline Result ExecuteStatement(const Handle<Interpreter>& interpreter) const
+        {
+            if (m_line > 0)
+            {
+                Heap::SetAllocationSite(m_line);
+            }
+
+            return Execute(interpreter);
+        }
+
     private:
+        /** Line number of the statement in source code. */
+        int m_line;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(Node);
     };
 
@@ -353,6 +387,7 @@ namespace tempearly
         Node* m_receiver;
         const String m_id;
         const bool m_null_safe;
+        mutable AttributeCache m_cache;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(AttributeNode);
     };
 
@@ -373,6 +408,7 @@ namespace tempearly
         const String m_id;
         const Vector<Node*> m_args;
         const bool m_null_safe;
+        mutable AttributeCache m_cache;
         TEMPEARLY_DISALLOW_COPY_AND_ASSIGN(CallNode);
     };
 
@@ -107,7 +107,7 @@ namespace tempearly
         {
             m_type->Mark();
         }
-        if (m_default_value && !m_default_value)
+        if (m_default_value && !m_default_value->IsMarked())
         {
             m_default_value->Mark();
         }
@@ -9,6 +9,7 @@ namespace tempearly
     static bool parse_text_block(const Handle<ScriptParser>&, Vector<Handle<Node> >&, bool&);
     static bool parse_script_block(const Handle<ScriptParser>&, Vector<Handle<Node> >&, bool&);
     static Handle<Node> parse_stmt(const Handle<ScriptParser>&);
+    static Handle<Node> parse_stmt_node(const Handle<ScriptParser>&);
     static Handle<Node> parse_expr(const Handle<ScriptParser>&);
     static Handle<Node> parse_postfix(const Handle<ScriptParser>&);
     static Handle<TypeHint> parse_typehint(const Handle<ScriptParser>&);
@@ -687,7 +688,7 @@ SCAN_EXPONENT:
                         token.kind = entry->GetValue();
                     } else {
                         token.kind = Token::IDENTIFIER;
-                        token.text = string;
+                        token.text = string.Intern();
                     }
                 } else {
                     SetErrorMessage("Unexpected input");
@@ -849,7 +850,9 @@ SCAN_EXPONENT:
                 else if (c == '{' || c == '!')
                 {
                     const bool escape = c != '!';
+                    const int line = parser->GetPosition().line;
                     Handle<Node> expr;
+                    Handle<Node> node;
 
                     if (!text.IsEmpty())
                     {
@@ -886,7 +889,9 @@ SCAN_EXPONENT:
 
                         return false;
                     }
-                    nodes.PushBack(new ExpressionNode(expr, escape));
+                    node = new ExpressionNode(expr, escape);
+                    node->SetLine(line);
+                    nodes.PushBack(node);
                     c = parser->ReadRune();
                 }
                 else if (c == '#')
@@ -1236,6 +1241,19 @@ SCAN_EXPONENT:
     }
 
     static Handle<Node> parse_stmt(const Handle<ScriptParser>& parser)
+    {
+        const int line = parser->PeekToken().position.line;
+        const Handle<Node> node = parse_stmt_node(parser);
+
+        if (node)
+        {
+            node->SetLine(line);
+        }
+
+        return node;
+    }
+
+    static Handle<Node> parse_stmt_node(const Handle<ScriptParser>& parser)
     {
         const ScriptParser::TokenDescriptor& token = parser->PeekToken();
         Handle<Node> node;
@@ -10,7 +10,7 @@ namespace tempearly
     {
         for (std::size_t i = 0; i < m_nodes.GetSize(); ++i)
         {
-            Result result = m_nodes[i]->Execute(interpreter);
+            Result result = m_nodes[i]->ExecuteStatement(interpreter);
 
             if (result.Is(Result::KIND_SUCCESS))
             {
@@ -13,33 +13,36 @@ namespace tempearly
 
     void Utils::ParseQueryString(const byte* input, std::size_t length, Dictionary<Vector<String> >& dictionary)
     {
-        ByteString name_in;
-        ByteString value_in;
         String name_out;
         String value_out;
 
+        // Names and values are decoded directly from the input, without
+        // copying them into separate buffers first.
         while (length > 0)
         {
-            const byte* begin = input;
-            const byte* end = static_cast<const byte*>(std::memchr(begin, '=', length));
+            const byte* name = input;
+            const byte* value;
+            std::size_t name_length;
+            std::size_t value_length;
+            const byte* end = static_cast<const byte*>(std::memchr(name, '=', length));
 
             if (!end)
             {
                 return;
             }
-            name_in = ByteString(begin, end - begin);
-            length -= end - begin + 1;
-            begin = end + 1;
-            if ((end = static_cast<const byte*>(std::memchr(begin, '&', length))))
+            name_length = end - name;
+            length -= name_length + 1;
+            value = end + 1;
+            if ((end = static_cast<const byte*>(std::memchr(value, '&', length))))
             {
-                value_in = ByteString(begin, end - begin);
-                length -= end - begin + 1;
+                value_length = end - value;
+                length -= value_length + 1;
                 input = end + 1;
             } else {
-                value_in = ByteString(begin, length);
+                value_length = length;
                 length = 0;
             }
-            if (Url::Decode(name_in, name_out) && Url::Decode(value_in, value_out))
+            if (Url::Decode(name, name_length, name_out) && Url::Decode(value, value_length, value_out))
             {
                 Dictionary<Vector<String> >::Entry* entry = dictionary.Find(name_out);
 